@@ -0,0 +1,48 @@
+#include <cstdio>
+#include <iostream>
+#include "Autosaver.h"
+#include "Stats.h"
+
+Autosaver::Autosaver(std::string filePath, std::chrono::milliseconds interval, SnapshotSource source)
+        : filePath(std::move(filePath)), interval(interval), source(std::move(source)), dirty(false),
+          stopping(false) {
+    worker = std::thread(&Autosaver::run, this);
+}
+
+Autosaver::~Autosaver() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void Autosaver::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        bool stop = wake.wait_for(lock, interval, [this] { return stopping; });
+
+        if (dirty.exchange(false, std::memory_order_relaxed)) {
+            lock.unlock();
+            write();
+            lock.lock();
+        }
+        if (stop) return;
+    }
+}
+
+void Autosaver::write() {
+    // Write next to the target and rename over it, so a crash never leaves a half-written snapshot.
+    STATS_TIME(AUTOSAVE);
+    std::string partialPath = filePath + ".partial";
+    Blackboard::Snapshot snapshot = source();
+    if (!Blackboard::saveSnapshot(snapshot, partialPath, SceneFile::formatFor(filePath))) return;
+
+#ifdef _WIN32
+    std::remove(filePath.c_str());
+#endif
+    if (std::rename(partialPath.c_str(), filePath.c_str()) != 0) {
+        std::cerr << "Autosave failed: cannot replace " << filePath << std::endl;
+    }
+}
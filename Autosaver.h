@@ -0,0 +1,48 @@
+#ifndef AUTOSAVER_H
+#define AUTOSAVER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "Blackboard.h"
+
+// Writes the scene to disk on a background thread at most once per interval, and only after it has
+// changed. Commands just raise a flag; taking the snapshot and writing the file happen off their path.
+class Autosaver {
+public:
+    using SnapshotSource = std::function<Blackboard::Snapshot()>;
+
+private:
+    std::string filePath;
+    std::chrono::milliseconds interval;
+    SnapshotSource source;
+
+    std::atomic<bool> dirty;
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread worker;
+
+    void run();
+
+    void write();
+
+public:
+    Autosaver(std::string filePath, std::chrono::milliseconds interval, SnapshotSource source);
+
+    ~Autosaver();
+
+    Autosaver(const Autosaver &) = delete;
+
+    Autosaver &operator=(const Autosaver &) = delete;
+
+    void notifyChanged() {
+        dirty.store(true, std::memory_order_relaxed);
+    }
+};
+
+#endif
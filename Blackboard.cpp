@@ -1,249 +1,734 @@
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include "Blackboard.h"
 #include "RaiiWrapper.h"
+#include "Stats.h"
 
-Blackboard::Blackboard(int w, int h) : width(w), height(h), nextShapeId(0) {
-    board.resize(height, std::vector<char>(width, ' '));
+namespace {
+    constexpr std::size_t shapeFootprint = SceneLoader::shapeFootprint;
+
+    // The layer every board starts with, and the one loaded scenes go to.
+    const char *const baseLayer = "base";
 }
 
-void Blackboard::draw() {
-    clearBoard();
+Blackboard::Blackboard(int w, int h) : width(w), height(h), nextShapeId(0), board(0, 0),
+                                       shapes(std::make_shared<std::vector<std::shared_ptr<Shape>>>()), index(w, h),
+                                       layers{{baseLayer, 0}}, changedRows(h, true),
+                                       output(std::make_unique<AnsiConsole>()) {
+    rasters.resize(layers.size());
+    setViewport(viewport);
+}
+
+class Blackboard::InsertCommand : public Command {
+private:
+    Blackboard &blackboard;
+    std::size_t id, layer;
+    std::shared_ptr<Shape> undone;
+
+public:
+    InsertCommand(Blackboard &blackboard, std::size_t id, std::size_t layer)
+            : blackboard(blackboard), id(id), layer(layer) {}
+
+    void undo() override {
+        undone = blackboard.eraseShape(id);
+    }
+
+    void redo() override {
+        blackboard.insertShape(id, layer, std::move(undone));
+    }
+
+    std::size_t footprint() const override {
+        return sizeof(*this) + (undone ? shapeFootprint : 0);
+    }
+};
+
+class Blackboard::EraseCommand : public Command {
+private:
+    Blackboard &blackboard;
+    std::size_t id, layer;
+    std::shared_ptr<Shape> erased;
+
+public:
+    EraseCommand(Blackboard &blackboard, std::size_t id, std::size_t layer, std::shared_ptr<Shape> erased)
+            : blackboard(blackboard), id(id), layer(layer), erased(std::move(erased)) {}
+
+    void undo() override {
+        blackboard.insertShape(id, layer, std::move(erased));
+    }
+
+    void redo() override {
+        erased = blackboard.eraseShape(id);
+    }
+
+    std::size_t footprint() const override {
+        return sizeof(*this) + (erased ? shapeFootprint : 0);
+    }
+};
+
+// Holds whichever version of a shape is not on the board; undo and redo both swap it back in.
+class Blackboard::ReplaceCommand : public Command {
+private:
+    Blackboard &blackboard;
+    std::size_t id;
+    std::shared_ptr<Shape> other;
+
+public:
+    ReplaceCommand(Blackboard &blackboard, std::size_t id, std::shared_ptr<Shape> previous)
+            : blackboard(blackboard), id(id), other(std::move(previous)) {}
+
+    void undo() override {
+        other = blackboard.exchangeShape(id, std::move(other));
+    }
+
+    void redo() override {
+        other = blackboard.exchangeShape(id, std::move(other));
+    }
+
+    std::size_t footprint() const override {
+        return sizeof(*this) + shapeFootprint;
+    }
+};
+
+// Swaps whole scenes, layers included, for clear and load; the scene that is not shown is moved,
+// never copied.
+class Blackboard::SceneCommand : public Command {
+private:
+    Blackboard &blackboard;
+    int width, height;
+    std::vector<std::shared_ptr<Shape>> shapes;
+    std::vector<Layer> layers;
+
+public:
+    SceneCommand(Blackboard &blackboard, int width, int height, std::vector<std::shared_ptr<Shape>> shapes,
+                 std::vector<Layer> layers)
+            : blackboard(blackboard), width(width), height(height), shapes(std::move(shapes)),
+              layers(std::move(layers)) {}
+
+    void undo() override {
+        blackboard.exchangeScene(width, height, shapes, layers);
+    }
+
+    void redo() override {
+        blackboard.exchangeScene(width, height, shapes, layers);
+    }
+
+    std::size_t footprint() const override {
+        return sizeof(*this) + shapes.capacity() * sizeof(shapes[0]) + shapes.size() * shapeFootprint +
+               layers.capacity() * sizeof(layers[0]);
+    }
+};
+
+std::size_t Blackboard::layerAt(std::size_t id) const {
+    auto it = std::upper_bound(layers.begin(), layers.end(), id,
+                               [](std::size_t value, const Layer &layer) { return value < layer.end; });
+    return static_cast<std::size_t>(it - layers.begin());
+}
+
+void Blackboard::insertShape(std::size_t id, std::size_t layer, std::shared_ptr<Shape> shape) {
+    Rect bounds = shape->getBounds();
+    store.insert(id, shape->toRecord());
+    auto &list = editShapes();
+    list.insert(list.begin() + id, std::move(shape));
+    for (std::size_t above = layer; above < layers.size(); ++above) {
+        ++layers[above].end;
+    }
+    // The selection follows its shape up.
+    if (shapeId >= 0 && static_cast<std::size_t>(shapeId) >= id) ++shapeId;
+    index.insert(id, bounds);
+    invalidate(layer, bounds);
+}
+
+std::shared_ptr<Shape> Blackboard::eraseShape(std::size_t id) {
+    std::size_t layer = layerAt(id);
+    auto &list = editShapes();
+    std::shared_ptr<Shape> shape = std::move(list[id]);
+    list.erase(list.begin() + id);
+    for (std::size_t above = layer; above < layers.size(); ++above) {
+        --layers[above].end;
+    }
+    // Erasing the selected shape drops the selection; one above it follows its shape down.
+    if (shapeId >= 0 && static_cast<std::size_t>(shapeId) == id) {
+        shapeId = -1;
+    } else if (shapeId >= 0 && static_cast<std::size_t>(shapeId) > id) {
+        --shapeId;
+    }
+    store.erase(id);
+    index.erase(id, shape->getBounds());
+    invalidate(layer, shape->getBounds());
+    return shape;
+}
+
+std::shared_ptr<Shape> Blackboard::exchangeShape(std::size_t id, std::shared_ptr<Shape> shape) {
+    std::size_t layer = layerAt(id);
+    auto &list = editShapes();
+    invalidate(layer, list[id]->getBounds());
+    std::swap(list[id], shape);
+    store.replace(id, list[id]->toRecord());
+    index.move(id, shape->getBounds(), list[id]->getBounds());
+    invalidate(layer, list[id]->getBounds());
+    return shape;
+}
+
+void Blackboard::exchangeScene(int &otherWidth, int &otherHeight, std::vector<std::shared_ptr<Shape>> &otherShapes,
+                               std::vector<Layer> &otherLayers) {
+    std::swap(width, otherWidth);
+    std::swap(height, otherHeight);
+    editShapes().swap(otherShapes);
+    layers.swap(otherLayers);
+
+    if (width != otherWidth || height != otherHeight) {
+        index.reset(width, height);
+        changedRows.assign(height, true);
+    }
+    rasters.resize(layers.size());
+    setViewport(viewport);
+    if (activeLayer >= layers.size()) activeLayer = layers.size() - 1;
+
+    store.rebuild(*shapes);
+    index.rebuild(*shapes);
+    shapeId = -1;
+    invalidateAll();
+}
 
-    for (const auto &shape: shapes) {
-        shape->draw(board);
+std::vector<std::shared_ptr<Shape>> &Blackboard::editShapes() {
+    if (shapesShared) {
+        STATS_ADD(SNAPSHOT_BYTES, shapes->size() * sizeof((*shapes)[0]));
+        shapes = std::make_shared<std::vector<std::shared_ptr<Shape>>>(*shapes);
+        shapesShared = false;
     }
+    return *shapes;
+}
+
+bool Blackboard::hasSelection() const {
+    if (shapeId < 0 || static_cast<std::size_t>(shapeId) >= shapes->size()) {
+        std::cout << "Invalid shape ID!\n";
+        return false;
+    }
+    return true;
+}
+
+void Blackboard::allocateBuffers() {
+    bool resized = false;
+    int boardWidth = isTiled() ? 0 : width, boardHeight = isTiled() ? 0 : height;
+    if (board.getWidth() != boardWidth || board.getHeight() != boardHeight) {
+        board.resize(boardWidth, boardHeight);
+        resized = true;
+    }
+    if (tiles.getWidth() != width - boardWidth || tiles.getHeight() != height - boardHeight) {
+        tiles.resize(width - boardWidth, height - boardHeight);
+        resized = true;
+    }
+    int cellsWidth = layers.size() > 1 ? boardWidth : 0, cellsHeight = layers.size() > 1 ? boardHeight : 0;
+    for (auto &raster: rasters) {
+        if (raster.cells.getWidth() != cellsWidth || raster.cells.getHeight() != cellsHeight) {
+            raster.cells.resize(cellsWidth, cellsHeight);
+            resized = true;
+        }
+    }
+    if (resized) invalidateAll();
+}
 
-    for (int i = 0; i < height; ++i) {
-        for (int j = 0; j < width; ++j) {
-            char symbol = board[i][j];
-            if (symbol != ' ') {
-                Colour colour = getCharColour(symbol);
-                setConsoleColour(colour);
-                std::cout << board[i][j] << ' ';
-                setConsoleColour(WHITE);
+void Blackboard::invalidate(std::size_t layer, const Rect &area) {
+    if (area.empty()) return;
+    if (!rasters[layer].fullRedraw) addDamage(rasters[layer].damage, area);
+    if (!fullRedraw) addDamage(damage, area);
+}
+
+void Blackboard::addDamage(std::vector<Rect> &rects, const Rect &area) {
+    Rect merged = area;
+    bool grown = true;
+    while (grown) {
+        grown = false;
+        for (auto it = rects.begin(); it != rects.end();) {
+            if (it->intersects(merged)) {
+                merged = merged.unite(*it);
+                it = rects.erase(it);
+                grown = true;
             } else {
-                std::cout << "  ";
+                ++it;
             }
         }
-        std::cout << std::endl;
+    }
+    rects.push_back(merged);
+
+    if (rects.size() > maxDamageRects) {
+        Rect all = rects.front();
+        for (const auto &rect: rects) {
+            all = all.unite(rect);
+        }
+        rects.assign(1, all);
     }
 }
 
-void Blackboard::clearBoard() {
-    for (int i = 0; i < height; ++i) {
-        for (int j = 0; j < width; ++j) {
-            board[i][j] = ' ';
+void Blackboard::invalidateAll() {
+    fullRedraw = true;
+    damage.clear();
+    for (auto &raster: rasters) {
+        raster.fullRedraw = true;
+        raster.damage.clear();
+    }
+}
+
+void Blackboard::render() {
+    STATS_TIME(RENDER);
+    Rect boardArea{0, 0, width - 1, height - 1};
+    allocateBuffers();
+
+    if (isTiled()) {
+        renderTiles(boardArea);
+    } else {
+        renderLayers(boardArea);
+    }
+
+    for (auto &raster: rasters) {
+        raster.damage.clear();
+        raster.fullRedraw = false;
+    }
+    damage.clear();
+    fullRedraw = false;
+}
+
+void Blackboard::renderLayers(const Rect &boardArea) {
+    // Layers that are stale as a whole can only come with a full redraw, which the bands take
+    // care of when there is a pool.
+    bool banded = fullRedraw && renderPool;
+    for (std::size_t layer = 0; layer < layers.size(); ++layer) {
+        if (!banded || !rasters[layer].fullRedraw) redrawLayer(layer, boardArea);
+    }
+
+    if (banded) {
+        renderBands(boardArea);
+    } else if (fullRedraw) {
+        composite(boardArea);
+    } else {
+        for (const auto &area: damage) {
+            Rect clip = area.intersect(boardArea);
+            if (clip.empty()) continue;
+
+            composite(clip);
+            std::fill(changedRows.begin() + clip.y0, changedRows.begin() + clip.y1 + 1, true);
+        }
+    }
+    if (fullRedraw) std::fill(changedRows.begin(), changedRows.end(), true);
+}
+
+void Blackboard::renderTiles(const Rect &boardArea) {
+    // Upper layers are transparent wherever they have no shapes, so drawing all of them in z-order
+    // gives what compositing per-layer caches would, without a cache the size of the board.
+    if (fullRedraw) {
+        tiles.clear();
+        store.drawAll(tiles, boardArea, 0, shapes->size());
+        return;
+    }
+
+    std::vector<std::size_t> ids;
+    for (const auto &area: damage) {
+        Rect clip = area.intersect(boardArea);
+        if (clip.empty()) continue;
+
+        tiles.fillRect(clip, ' ');
+        index.query(clip, ids);
+        for (std::size_t id: ids) {
+            if (store.bounds(id).intersects(clip)) store.draw(id, tiles, clip);
+        }
+    }
+}
+
+void Blackboard::redrawLayer(std::size_t layer, const Rect &boardArea) {
+    LayerRaster &raster = rasters[layer];
+    Framebuffer &cells = cacheOf(layer);
+    char clear = layer ? '\0' : ' ';
+    std::size_t first = layerBegin(layer), last = layers[layer].end;
+
+    if (raster.fullRedraw) {
+        cells.fill(clear);
+        store.drawAll(cells, boardArea, first, last);
+        return;
+    }
+
+    std::vector<std::size_t> ids;
+    for (const auto &area: raster.damage) {
+        Rect clip = area.intersect(boardArea);
+        if (clip.empty()) continue;
+
+        cells.fillRect(clip, clear);
+        index.query(clip, ids);
+        for (std::size_t id: ids) {
+            if (id >= first && id < last && store.bounds(id).intersects(clip)) store.draw(id, cells, clip);
+        }
+    }
+}
+
+void Blackboard::composite(const Rect &clip) {
+    if (layers.size() == 1) return;
+
+    auto columns = static_cast<std::size_t>(clip.x1 - clip.x0 + 1);
+    for (int y = clip.y0; y <= clip.y1; ++y) {
+        std::memcpy(board.span(y, clip.x0), rasters[0].cells.span(y, clip.x0), columns);
+    }
+    for (std::size_t layer = 1; layer < layers.size(); ++layer) {
+        if (layerBegin(layer) == layers[layer].end) continue;
+        for (int y = clip.y0; y <= clip.y1; ++y) {
+            Simd::overlay(board.span(y, clip.x0), rasters[layer].cells.span(y, clip.x0), columns);
+        }
+    }
+}
+
+void Blackboard::renderBands(const Rect &boardArea) {
+    // A few bands per thread so stealing can even out bands that hold more shapes than others.
+    int bandCount = std::min<int>(height, static_cast<int>(renderPool->threadCount()) * 4);
+    int bandHeight = (height + bandCount - 1) / bandCount;
+    bandCount = (height + bandHeight - 1) / bandHeight;
+
+    bandShapes.resize(bandCount);
+    for (auto &band: bandShapes) {
+        band.clear();
+    }
+    for (std::size_t layer = 0; layer < layers.size(); ++layer) {
+        if (!rasters[layer].fullRedraw) continue;
+        for (std::size_t id = layerBegin(layer); id < layers[layer].end; ++id) {
+            Rect bounds = store.bounds(id).intersect(boardArea);
+            if (bounds.empty()) continue;
+            for (int band = bounds.y0 / bandHeight; band <= bounds.y1 / bandHeight; ++band) {
+                bandShapes[band].push_back(id);
+            }
+        }
+    }
+
+    renderPool->parallelFor(bandCount, [&](std::size_t band) {
+        int y0 = static_cast<int>(band) * bandHeight;
+        Rect clip{0, y0, width - 1, std::min(height - 1, y0 + bandHeight - 1)};
+
+        for (std::size_t layer = 0; layer < layers.size(); ++layer) {
+            if (rasters[layer].fullRedraw) cacheOf(layer).fillRect(clip, layer ? '\0' : ' ');
+        }
+        std::size_t layer = 0;
+        for (std::size_t id: bandShapes[band]) {
+            while (id >= layers[layer].end) ++layer;
+            store.draw(id, cacheOf(layer), clip);
+        }
+        composite(clip);
+    });
+}
+
+void Blackboard::setRenderThreads(unsigned threads) {
+    if (threads <= 1) {
+        renderPool.reset();
+    } else {
+        renderPool = std::make_unique<ThreadPool>(threads);
+    }
+    bandShapes.clear();
+}
+
+unsigned Blackboard::getRenderThreads() const {
+    return renderPool ? renderPool->threadCount() : 1;
+}
+
+const Framebuffer &Blackboard::renderViewport() {
+    STATS_TIME(RENDER);
+    int zoom = viewport.zoom;
+    // The window can reach far past the board, so its far edge is clamped in 64 bits.
+    long long right = viewport.x + static_cast<long long>(viewport.columns) * zoom - 1;
+    long long bottom = viewport.y + static_cast<long long>(viewport.rows) * zoom - 1;
+    Rect area{viewport.x, viewport.y, static_cast<int>(std::min<long long>(right, width - 1)),
+              static_cast<int>(std::min<long long>(bottom, height - 1))};
+    area = area.intersect({0, 0, width - 1, height - 1});
+
+    if (viewFrame.getWidth() != viewport.columns || viewFrame.getHeight() != viewport.rows) {
+        viewFrame.resize(viewport.columns, viewport.rows);
+    } else {
+        viewFrame.fill(' ');
+    }
+    if (area.empty()) return viewFrame;
+
+    // Ids come back in z-order, which is also layer order.
+    std::vector<std::size_t> ids;
+    index.query(area, ids);
+    for (std::size_t id: ids) {
+        if (store.bounds(id).intersects(area)) store.draw(id, viewFrame, area, viewport.x, viewport.y, zoom);
+    }
+    return viewFrame;
+}
+
+void Blackboard::draw() {
+    if (viewport.columns > 0) {
+        const Framebuffer &frame = renderViewport();
+        STATS_TIME(PRESENT);
+        output->present(frame, std::vector<bool>(frame.getHeight(), true));
+        return;
+    }
+
+    render();
+    {
+        STATS_TIME(PRESENT);
+        output->present(board, changedRows);
+    }
+    std::fill(changedRows.begin(), changedRows.end(), false);
+}
+
+void Blackboard::setViewport(const Viewport &view) {
+    viewport = view;
+    if ((viewport.columns <= 0 || viewport.rows <= 0) && isTiled()) {
+        viewport = {0, 0, defaultViewColumns, defaultViewRows, 1};
+    } else if (viewport.columns <= 0 || viewport.rows <= 0) {
+        viewport = {0, 0, 0, 0, 1};
+        // The output last saw a viewport frame, so the board goes out whole next time.
+        std::fill(changedRows.begin(), changedRows.end(), true);
+        return;
+    }
+    viewport.zoom = std::max(viewport.zoom, 1);
+    long long spanX = static_cast<long long>(viewport.columns) * viewport.zoom;
+    long long spanY = static_cast<long long>(viewport.rows) * viewport.zoom;
+    viewport.x = static_cast<int>(std::max(0LL, std::min<long long>(viewport.x, width - spanX)));
+    viewport.y = static_cast<int>(std::max(0LL, std::min<long long>(viewport.y, height - spanY)));
+}
+
+void Blackboard::present(FrameSink &sink) {
+    if (isTiled()) {
+        const Framebuffer &frame = renderViewport();
+        sink.present(frame, std::vector<bool>(frame.getHeight(), true));
+        return;
+    }
+    render();
+    sink.present(board, std::vector<bool>(height, true));
+}
+
+bool Blackboard::exportImage(const std::string &filePath) {
+    try {
+        render();
+        if (isTiled()) {
+            ImageSink::write(tiles, filePath, ImageSink::formatFor(filePath));
+        } else {
+            ImageSink::write(board, filePath, ImageSink::formatFor(filePath));
         }
+        return true;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return false;
     }
 }
 
+void Blackboard::setOutput(std::unique_ptr<FrameSink> sink) {
+    output = std::move(sink);
+    std::fill(changedRows.begin(), changedRows.end(), true);
+}
+
+void Blackboard::clearBoard() {
+    board.fill(' ');
+    tiles.clear();
+}
+
 bool Blackboard::addShape(const std::shared_ptr<Shape> &shape) {
+    STATS_TIME(ADD_SHAPE);
     if (!shape->isWithinBounds(width, height)) {
-        std::cout << "Shape cannot be placed outside the board or is too large for the board." << std::endl;
+        std::cout << "Shape cannot be placed outside the board or is too large for the board.\n";
         return false;
     }
-    for (const auto &s: shapes) {
-        if (s->isSameSpot(*shape)) {
-            std::cout << "Shape already exists at the same spot." << std::endl;
+    ShapeRecord record = shape->toRecord();
+    std::vector<std::size_t> candidates;
+    index.candidatesAt(record.x, record.y, candidates);
+    for (std::size_t id: candidates) {
+        if (store.sameSpot(id, record)) {
+            std::cout << "Shape already exists at the same spot.\n";
             return false;
         }
     }
 
-    undoStack.push_back(shapes);
-    shapes.push_back(shape);
+    std::size_t id = layers[activeLayer].end;
+    insertShape(id, activeLayer, shape);
+    history.push(std::make_unique<InsertCommand>(*this, id, activeLayer));
     return true;
 }
 
 bool Blackboard::clear() {
-    undoStack.push_back(shapes);
-    shapes.clear();
+    int clearedWidth = width, clearedHeight = height;
+    std::vector<std::shared_ptr<Shape>> cleared;
+    std::vector<Layer> clearedLayers = layers;
+    for (auto &layer: clearedLayers) {
+        layer.end = 0;
+    }
+    exchangeScene(clearedWidth, clearedHeight, cleared, clearedLayers);
+    history.push(std::make_unique<SceneCommand>(*this, clearedWidth, clearedHeight, std::move(cleared),
+                                                std::move(clearedLayers)));
+    // The cleared shapes live on in history; this gives back chunks that earlier scenes emptied.
+    BlockPool::trimAll();
     return true;
 }
 
+void Blackboard::beginBatch() {
+    history.beginGroup();
+}
+
+void Blackboard::endBatch() {
+    history.endGroup();
+}
+
+bool Blackboard::undo() {
+    return history.undo();
+}
+
+bool Blackboard::redo() {
+    return history.redo();
+}
+
 void Blackboard::listShapes() const {
     std::cout << "Shapes on the blackboard:\n";
-    for (size_t i = 0; i < shapes.size(); ++i) {
-        const auto &shape = shapes[i];
-        std::cout << "\tID: " << i << ", Type: " << shape->getType()
+    for (size_t i = 0; i < shapes->size(); ++i) {
+        const auto &shape = (*shapes)[i];
+        std::cout << "\tID: " << i;
+        if (layers.size() > 1) std::cout << ", Layer: " << layers[layerAt(i)].name;
+        std::cout << ", Type: " << shape->getType()
                   << ", Position: (" << shape->getPosition().first
                   << ", " << shape->getPosition().second << "), "
-                  << shape->describe() << std::endl;
+                  << shape->describe() << '\n';
     }
 }
 
-bool Blackboard::save(const std::string &filePath) const {
-    try {
-        RaiiWrapper file(filePath, true);
+void Blackboard::useLayer(const std::string &name) {
+    for (std::size_t layer = 0; layer < layers.size(); ++layer) {
+        if (layers[layer].name == name) {
+            activeLayer = layer;
+            std::cout << "Drawing on layer " << name << ".\n";
+            return;
+        }
+    }
+    layers.push_back({name, shapes->size()});
+    rasters.resize(layers.size());
+    invalidateAll();
+    activeLayer = layers.size() - 1;
+    std::cout << "Layer " << name << " added on top.\n";
+}
+
+void Blackboard::listLayers() const {
+    std::cout << "Layers, bottom first:\n";
+    for (std::size_t layer = 0; layer < layers.size(); ++layer) {
+        std::cout << '\t' << (layer == activeLayer ? "* " : "  ") << layers[layer].name << " ("
+                  << layers[layer].end - layerBegin(layer) << " shapes)\n";
+    }
+}
+
+bool Blackboard::save(const std::string &filePath, SceneFormat format) const {
+    STATS_TIME(SAVE);
+    return saveSnapshot({width, height, shapes}, filePath, format);
+}
 
-        file.getOutputStream() << width << ' ' << height << '\n';
+Blackboard::Snapshot Blackboard::snapshot() const {
+    shapesShared = true;
+    return {width, height, shapes};
+}
 
-        for (const auto &shape : shapes) {
-            shape->serialize(file.getOutputStream());
+bool Blackboard::saveSnapshot(const Snapshot &snapshot, const std::string &filePath, SceneFormat format) {
+    try {
+        bool binary = format == SceneFormat::BINARY;
+        RaiiWrapper file(filePath, true, binary);
+        if (binary) {
+            SceneFile::writeBinary(file.getOutputStream(), snapshot.width, snapshot.height, *snapshot.shapes);
+        } else {
+            SceneFile::writeText(file.getOutputStream(), snapshot.width, snapshot.height, *snapshot.shapes);
         }
+        STATS_ADD(FILE_BYTES_WRITTEN, std::max<std::streamoff>(0, file.getOutputStream().tellp()));
         return true;
     } catch (const std::exception &e) {
-        std::cerr << e.what() << std::endl;
+        std::cerr << e.what() << '\n';
         return false;
     }
 }
 
 bool Blackboard::load(const std::string &filePath) {
+    STATS_TIME(LOAD);
     std::vector<std::shared_ptr<Shape>> loadedShapes;
     try {
-        RaiiWrapper file(filePath, false);
-
-        int newWidth, newHeight;
-        file.getInputStream() >> newWidth >> newHeight;
-
-        if (newWidth <= 0 || newHeight <= 0) {
-            throw std::runtime_error("Invalid board dimensions.");
-        }
-
-        width = newWidth;
-        height = newHeight;
-
-        board.resize(height);
-        for (auto &row: board) {
-            row.resize(width);
-        }
+        int newWidth = 0, newHeight = 0;
+        loadOptions.pool = renderPool.get();
+        SceneLoader::load(filePath, loadOptions, newWidth, newHeight, loadedShapes);
 
-        clear();
-
-        std::string shapeType;
-        while (file.getInputStream() >> shapeType) {
-            int x, y;
-            char colour;
-            bool fillMode;
-            file.getInputStream() >> x >> y >> colour >> fillMode;
-
-            if (x < 0 || y < 0 || x >= width || y >= height) {
-                throw std::runtime_error("Invalid position for shape.");
-            }
-
-            if (shapeType == "Rectangle") {
-                int w, h;
-                file.getInputStream() >> w >> h;
-                if (w <= 0 || h <= 0) {
-                    throw std::runtime_error("Invalid dimensions for Rectangle.");
-                }
-                auto rect = std::make_shared<SRectangle>(x, y, colour, fillMode, w, h);
-                if (!rect->isWithinBounds(width, height)) {
-                    throw std::runtime_error("Rectangle out of bounds.");
-                }
-                loadedShapes.push_back(rect);
-            } else if (shapeType == "Circle") {
-                int radius;
-                file.getInputStream() >> radius;
-                if (radius <= 0) {
-                    throw std::runtime_error("Invalid radius for Circle.");
-                }
-                auto circ = std::make_shared<Circle>(x, y, colour, fillMode, radius);
-                if (!circ->isWithinBounds(width, height)) {
-                    throw std::runtime_error("Circle out of bounds.");
-                }
-                loadedShapes.push_back(circ);
-            } else if (shapeType == "Triangle") {
-                int h, w;
-                file.getInputStream() >> h >> w;
-                if (h <= 0 || w <= 0) {
-                    throw std::runtime_error("Invalid dimensions for Triangle.");
-                }
-                auto tri = std::make_shared<Triangle>(x, y, colour, fillMode, h, w);
-                if (!tri->isWithinBounds(width, height)) {
-                    throw std::runtime_error("Triangle out of bounds.");
-                }
-                loadedShapes.push_back(tri);
-            } else if (shapeType == "Line") {
-                int length;
-                double angle;
-                file.getInputStream() >> length >> angle;
-                if (length <= 0) {
-                    throw std::runtime_error("Invalid length for Line.");
-                }
-                auto line = std::make_shared<Line>(x, y, colour, fillMode, length, angle);
-                if (!line->isWithinBounds(width, height)) {
-                    throw std::runtime_error("Line out of bounds.");
-                }
-                loadedShapes.push_back(line);
-            } else {
-                throw std::runtime_error("Unknown shape type: " + shapeType);
-            }
-        }
-        undoStack.push_back(shapes);
-        clear();
-        shapes = std::move(loadedShapes);
+        std::vector<Layer> loadedLayers{{baseLayer, loadedShapes.size()}};
+        exchangeScene(newWidth, newHeight, loadedShapes, loadedLayers);
+        history.push(std::make_unique<SceneCommand>(*this, newWidth, newHeight, std::move(loadedShapes),
+                                                    std::move(loadedLayers)));
+        BlockPool::trimAll();
         return true;
     } catch (const std::exception &e) {
-        std::cerr << "Failed to load blackboard: " << e.what() << std::endl;
+        std::cerr << "Failed to load blackboard: " << e.what() << '\n';
+        // A load that fails part way has just freed every shape it parsed.
+        loadedShapes.clear();
+        BlockPool::trimAll();
         return false;
     }
 }
 
+void Blackboard::setLoadLimit(std::size_t bytes) {
+    loadOptions.memoryLimit = bytes;
+}
+
+void Blackboard::setLoadProgress(std::function<void(std::uint64_t, std::uint64_t)> progress) {
+    loadOptions.progress = std::move(progress);
+}
+
 bool Blackboard::removeShape() {
-    if (shapeId < 0 || shapeId >= shapes.size()) {
-        std::cout << "Invalid shape ID!" << std::endl;
-        return false;
-    }
-    undoStack.push_back(shapes);
-    shapes.erase(shapes.begin() + shapeId);
-    std::cout << "Shape removed successfully." << std::endl;
+    if (!hasSelection()) return false;
+    auto id = static_cast<std::size_t>(shapeId);
+    std::size_t layer = layerAt(id);
+    // eraseShape drops the selection, so the id is read first.
+    std::shared_ptr<Shape> erased = eraseShape(id);
+    history.push(std::make_unique<EraseCommand>(*this, id, layer, std::move(erased)));
+    std::cout << "Shape removed successfully.\n";
     return true;
 }
 
-bool Blackboard::editParams(const std::vector<float> &values) {
-    if (shapeId < 0 || shapeId >= shapes.size()) {
-        std::cout << "Invalid shape ID!" << std::endl;
+bool Blackboard::editParams(const float *values, std::size_t count) {
+    if (!hasSelection()) return false;
+    auto edited = (*shapes)[shapeId]->clone();
+    if (!edited->editSize(values, count)) return false;
+    if (!edited->isWithinBounds(width, height)) {
+        std::cout << "Shape cannot be placed outside the board or is too large for the board.\n";
         return false;
     }
-    undoStack.push_back(shapes);
-    shapes[shapeId]->editSize(values);
+    history.push(std::make_unique<ReplaceCommand>(*this, shapeId, exchangeShape(shapeId, edited)));
     return true;
 }
 
 bool Blackboard::editPosition(int x, int y) {
-    if (shapeId < 0 || shapeId >= shapes.size()) {
-        std::cout << "Invalid shape ID!" << std::endl;
-        return false;
-    }
+    if (!hasSelection()) return false;
     if (x >= 0 && y >= 0 && x < width && y < height) {
-        undoStack.push_back(shapes);
-        shapes[shapeId]->editPosition(x, y);
-        std::cout << "Shape #" << shapeId << " moved to (" << x << ", " << y << ") successfully." << std::endl;
+        auto moved = (*shapes)[shapeId]->clone();
+        moved->editPosition(x, y);
+        history.push(std::make_unique<ReplaceCommand>(*this, shapeId, exchangeShape(shapeId, moved)));
+        std::cout << "Shape #" << shapeId << " moved to (" << x << ", " << y << ") successfully.\n";
         return true;
     }
-    std::cout << "Position out of bounds." << std::endl;
+    std::cout << "Position out of bounds.\n";
     return false;
 }
 
 bool Blackboard::editColour(char colour) {
-    if (shapeId < 0 || shapeId >= shapes.size()) {
-        std::cout << "Invalid shape ID!" << std::endl;
-        return false;
-    }
-    undoStack.push_back(shapes);
-    shapes[shapeId]->editColour(colour);
+    if (!hasSelection()) return false;
+    auto painted = (*shapes)[shapeId]->clone();
+    painted->editColour(colour);
+    history.push(std::make_unique<ReplaceCommand>(*this, shapeId, exchangeShape(shapeId, painted)));
     return true;
 }
 
 void Blackboard::selectId(int id) {
-    if (id >= 0 && id < shapes.size()) {
+    if (id >= 0 && static_cast<std::size_t>(id) < shapes->size()) {
         shapeId = id;
         std::cout << "Shape #" << id << " selected.\n";
     } else {
-        std::cout << "Invalid shape index!" << std::endl;
+        std::cout << "Invalid shape index!\n";
     }
 }
 
 void Blackboard::selectPosition(int x, int y) {
-    for (size_t i = 0; i < shapes.size(); ++i) {
-        const auto &shape = shapes[shapes.size() - i - 1];
-        if (shape->coversPoint(board, x, y)) {
-            shapeId = shapes.size() - i - 1;
-            std::cout << "Shape detected at (" << x << ", " << y << ")." << std::endl;
+    std::vector<std::size_t> candidates;
+    index.candidatesAt(x, y, candidates);
+    for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) {
+        if (store.covers(*it, x, y)) {
+            shapeId = static_cast<int>(*it);
+            std::cout << "Shape detected at (" << x << ", " << y << ").\n";
             return;
-        } else {
-            shapeId = -1;
         }
     }
-    std::cout << "No shape detected at (" << x << ", " << y << ")." << std::endl;
+    shapeId = -1;
+    std::cout << "No shape detected at (" << x << ", " << y << ").\n";
 }
@@ -1,55 +1,202 @@
 #ifndef BLACKBOARD_H
 #define BLACKBOARD_H
 
+#include <string>
 #include <vector>
 #include <memory>
-#include <windows.h>
+#include "ConsoleOutput.h"
+#include "Framebuffer.h"
+#include "History.h"
+#include "SceneFile.h"
+#include "SceneLoader.h"
+#include "SceneStore.h"
 #include "Shape.h"
+#include "SpatialIndex.h"
+#include "ThreadPool.h"
+#include "TiledFramebuffer.h"
 
 class Blackboard {
+public:
+    // The part of the board draw shows: columns x rows cells on screen starting at board cell (x, y),
+    // each standing for a zoom x zoom block of the board.
+    struct Viewport {
+        int x, y, columns, rows, zoom;
+    };
+
+    // What a board too big for a dense framebuffer shows when no viewport was picked.
+    static constexpr int defaultViewColumns = 40, defaultViewRows = 20;
+
 private:
-    int width, height, nextShapeId, shapeId;
-    std::vector<std::vector<char>> board;
-    std::vector<std::shared_ptr<Shape>> shapes;
-
-    enum Colour {
-        BLACK = 0,
-        BLUE = 1,
-        GREEN = 2,
-        RED = 4,
-        YELLOW = 6,
-        WHITE = 7
+    int width, height, nextShapeId, shapeId = -1;
+    Framebuffer board;
+
+    // Boards with more cells than this render into tiles instead of board, and are only ever shown
+    // through a viewport.
+    static constexpr std::uint64_t maxDenseCells = std::uint64_t(1) << 26;
+    TiledFramebuffer tiles{0, 0};
+
+    // Shared copy-on-write with snapshots: taking one copies this pointer and marks the list shared, and
+    // the first edit after that copies the list before changing it. A flag rather than use_count, since
+    // a snapshot is released on the autosave thread with nothing ordering it before the next edit.
+    // Reads go through the pointer; edits go through editShapes.
+    std::shared_ptr<std::vector<std::shared_ptr<Shape>>> shapes;
+    mutable bool shapesShared = false;
+    SceneStore store;
+    SpatialIndex index;
+
+    // Shapes are kept in layer order: a layer owns the ids from the previous layer's end up to its
+    // own, so z-order over the whole list is also the order the layers are composited in.
+    struct Layer {
+        std::string name;
+        std::size_t end;
     };
 
-    Colour getCharColour(char colourChar) {
-        switch (colourChar) {
-            case 'k':
-                return BLACK;
-            case 'b':
-                return BLUE;
-            case 'g':
-                return GREEN;
-            case 'r':
-                return RED;
-            case 'y':
-                return YELLOW;
-            default:
-                return WHITE;
-        }
+    // Cached raster of one layer and the regions of it that are stale. The bottom layer is cleared
+    // to ' ', the ones above it to '\0' where they are transparent.
+    struct LayerRaster {
+        Framebuffer cells{0, 0};
+        std::vector<Rect> damage;
+        bool fullRedraw = true;
+    };
+
+    std::vector<Layer> layers;
+    std::vector<LayerRaster> rasters;
+    std::size_t activeLayer = 0;
+
+    // With a single layer the board itself is that layer's cache and nothing is composited, so
+    // the rasters only hold cells while there are several layers. render sizes the board and the
+    // caches on first use, so a board that is only shown through a viewport never allocates them.
+    void allocateBuffers();
+
+    Framebuffer &cacheOf(std::size_t layer) {
+        return layers.size() == 1 ? board : rasters[layer].cells;
     }
 
-    void setConsoleColour(Colour colour) {
-        HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-        SetConsoleTextAttribute(hConsole, colour);
+    std::size_t layerBegin(std::size_t layer) const {
+        return layer ? layers[layer - 1].end : 0;
     }
 
-    std::vector<std::vector<std::shared_ptr<Shape>>> undoStack = {};
+    std::size_t layerAt(std::size_t id) const;
+
+    static constexpr std::size_t maxDamageRects = 32;
+
+    // Regions of the board that need compositing since the last render, and the rows rewritten
+    // since output last took a frame.
+    std::vector<Rect> damage;
+    bool fullRedraw = true;
+    std::vector<bool> changedRows;
+
+    static void addDamage(std::vector<Rect> &rects, const Rect &area);
+
+    void invalidate(std::size_t layer, const Rect &area);
+
+    // Brings the board and the layer caches up to date.
+    void renderLayers(const Rect &boardArea);
+
+    // Draws the stale regions of every layer straight into the tiles, in z-order.
+    void renderTiles(const Rect &boardArea);
+
+    // Re-rasterizes the stale regions of one layer's cache.
+    void redrawLayer(std::size_t layer, const Rect &boardArea);
+
+    // Merges the layer caches into the board, bottom layer first.
+    void composite(const Rect &clip);
+
+    // Full redraws split the board into row bands and rasterize them on renderPool. Each band gets
+    // the ids of the shapes whose bounds reach it, in z-order, so it comes out the same as a serial pass.
+    std::unique_ptr<ThreadPool> renderPool;
+    std::vector<std::vector<std::size_t>> bandShapes;
+
+    void renderBands(const Rect &boardArea);
+
+    Viewport viewport{0, 0, 0, 0, 1};
+    Framebuffer viewFrame{0, 0};
+
+    std::unique_ptr<FrameSink> output;
+
+    // load parses on renderPool; the rest is set through setLoadLimit and setLoadProgress.
+    SceneLoader::Options loadOptions;
+
+    class InsertCommand;
+
+    class EraseCommand;
+
+    class ReplaceCommand;
+
+    class SceneCommand;
+
+    History history;
+
+    // Primitive scene edits shared by the public operations and by the history commands. Each keeps
+    // the scene store, the spatial index and the damaged regions in step with shapes. Inserting or
+    // erasing below the top only shifts flat id arrays; no cell or pool is walked.
+    void insertShape(std::size_t id, std::size_t layer, std::shared_ptr<Shape> shape);
+
+    std::shared_ptr<Shape> eraseShape(std::size_t id);
+
+    std::shared_ptr<Shape> exchangeShape(std::size_t id, std::shared_ptr<Shape> shape);
+
+    void exchangeScene(int &otherWidth, int &otherHeight, std::vector<std::shared_ptr<Shape>> &otherShapes,
+                       std::vector<Layer> &otherLayers);
+
+    // The shape list, copied first if a snapshot may still hold it.
+    std::vector<std::shared_ptr<Shape>> &editShapes();
+
+    bool hasSelection() const;
 
 public:
+    // Shapes are never changed in place once they are on the board, and the board copies its shape
+    // list before editing one a snapshot holds, so a snapshot is a consistent view that another thread
+    // can read while the board moves on. Taking it costs one pointer copy.
+    struct Snapshot {
+        int width, height;
+        std::shared_ptr<const std::vector<std::shared_ptr<Shape>>> shapes;
+    };
+
     Blackboard(int w, int h);
 
+    // Brings the board's framebuffer, or its tiles on a tiled board, up to date without presenting
+    // it anywhere.
+    void render();
+
+    bool isTiled() const {
+        return static_cast<std::uint64_t>(width) * static_cast<std::uint64_t>(height) > maxDenseCells;
+    }
+
+    // Rasterizes only what the viewport shows, straight from the scene, and returns that frame. With
+    // a zoom above one each cell shows the topmost shape covering the centre of its block of the
+    // board, so shapes thinner than a block can fall between samples.
+    const Framebuffer &renderViewport();
+
+    // Renders and hands the frame to the output sink (the terminal unless replaced): the viewport
+    // when one is set, the whole board otherwise.
     void draw();
 
+    // Clamps the viewport onto the board. A viewport without columns or rows shows the whole board,
+    // or the default window at the top left of a tiled board.
+    void setViewport(const Viewport &view);
+
+    const Viewport &getViewport() const {
+        return viewport;
+    }
+
+    // Renders and hands the whole frame to sink, leaving the output sink's view untouched. A tiled
+    // board hands over its viewport instead.
+    void present(FrameSink &sink);
+
+    // Writes the current frame as a PPM or PGM image, picked by the file extension.
+    bool exportImage(const std::string &filePath);
+
+    // Makes the next draw repaint the whole board instead of only the regions that changed.
+    void invalidateAll();
+
+    void setOutput(std::unique_ptr<FrameSink> sink);
+
+    // 0 or 1 keeps rendering on the calling thread.
+    void setRenderThreads(unsigned threads);
+
+    unsigned getRenderThreads() const;
+
     void clearBoard();
 
     bool addShape(const std::shared_ptr<Shape> &shape);
@@ -58,13 +205,37 @@ public:
 
     bool clear();
 
+    // Changes made between beginBatch and the matching endBatch undo and redo as a single step.
+    void beginBatch();
+
+    void endBatch();
+
+    bool undo();
+
+    bool redo();
+
     void listShapes() const;
 
-    bool save(const std::string &filePath) const;
+    // Layers stack in the order they were made, the first at the bottom, and new shapes go to the
+    // active one. Making and switching layers is not recorded in the history.
+    void useLayer(const std::string &name);
+
+    void listLayers() const;
+
+    bool save(const std::string &filePath, SceneFormat format = SceneFormat::TEXT) const;
 
     bool load(const std::string &filePath);
 
-    bool editParams(const std::vector<float> &values);
+    // Fails any load whose file buffer and shapes would take more than bytes; 0 lifts the limit.
+    void setLoadLimit(std::size_t bytes);
+
+    void setLoadProgress(std::function<void(std::uint64_t, std::uint64_t)> progress);
+
+    Snapshot snapshot() const;
+
+    static bool saveSnapshot(const Snapshot &snapshot, const std::string &filePath, SceneFormat format);
+
+    bool editParams(const float *values, std::size_t count);
 
     bool editPosition(int x, int y);
 
@@ -1,92 +1,374 @@
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include "CLI.h"
+#include "MappedFile.h"
+#include "ShapeRegistry.h"
+#include "Stats.h"
+
+namespace {
+    enum class CommandId {
+        DRAW,
+        LIST,
+        SHAPES,
+        ADD,
+        REMOVE,
+        UNDO,
+        REDO,
+        CLEAR,
+        SELECT,
+        EDIT,
+        MOVE,
+        PAINT,
+        SAVE,
+        LOAD,
+        EXPORT,
+        THREADS,
+        LAYER,
+        VIEW,
+        PAN,
+        ZOOM,
+        STATS,
+        RUN,
+        HELP,
+        UNKNOWN
+    };
+
+    constexpr std::uint32_t commandHash(std::string_view name) {
+        std::uint32_t hash = 2166136261u;
+        for (char c: name) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+        }
+        return hash;
+    }
+
+    CommandId matchCommand(std::string_view name, std::string_view expected, CommandId id) {
+        return name == expected ? id : CommandId::UNKNOWN;
+    }
+
+    // The hash is perfect over the command names: a collision would be a duplicate case label.
+    CommandId lookupCommand(std::string_view name) {
+        switch (commandHash(name)) {
+            case commandHash("draw"):
+                return matchCommand(name, "draw", CommandId::DRAW);
+            case commandHash("list"):
+                return matchCommand(name, "list", CommandId::LIST);
+            case commandHash("shapes"):
+                return matchCommand(name, "shapes", CommandId::SHAPES);
+            case commandHash("add"):
+                return matchCommand(name, "add", CommandId::ADD);
+            case commandHash("remove"):
+                return matchCommand(name, "remove", CommandId::REMOVE);
+            case commandHash("undo"):
+                return matchCommand(name, "undo", CommandId::UNDO);
+            case commandHash("redo"):
+                return matchCommand(name, "redo", CommandId::REDO);
+            case commandHash("clear"):
+                return matchCommand(name, "clear", CommandId::CLEAR);
+            case commandHash("select"):
+                return matchCommand(name, "select", CommandId::SELECT);
+            case commandHash("edit"):
+                return matchCommand(name, "edit", CommandId::EDIT);
+            case commandHash("move"):
+                return matchCommand(name, "move", CommandId::MOVE);
+            case commandHash("paint"):
+                return matchCommand(name, "paint", CommandId::PAINT);
+            case commandHash("save"):
+                return matchCommand(name, "save", CommandId::SAVE);
+            case commandHash("load"):
+                return matchCommand(name, "load", CommandId::LOAD);
+            case commandHash("export"):
+                return matchCommand(name, "export", CommandId::EXPORT);
+            case commandHash("threads"):
+                return matchCommand(name, "threads", CommandId::THREADS);
+            case commandHash("layer"):
+                return matchCommand(name, "layer", CommandId::LAYER);
+            case commandHash("view"):
+                return matchCommand(name, "view", CommandId::VIEW);
+            case commandHash("pan"):
+                return matchCommand(name, "pan", CommandId::PAN);
+            case commandHash("zoom"):
+                return matchCommand(name, "zoom", CommandId::ZOOM);
+            case commandHash("stats"):
+                return matchCommand(name, "stats", CommandId::STATS);
+            case commandHash("run"):
+                return matchCommand(name, "run", CommandId::RUN);
+            case commandHash("help"):
+                return matchCommand(name, "help", CommandId::HELP);
+            default:
+                return CommandId::UNKNOWN;
+        }
+    }
+
+    int clampToInt(long long value) {
+        return static_cast<int>(std::max<long long>(std::numeric_limits<int>::min(),
+                                                    std::min<long long>(value, std::numeric_limits<int>::max())));
+    }
+
+    // The view, pan and zoom commands. pan and zoom start from a default view when none is set.
+    void changeView(Blackboard &blackboard, CommandId id, CommandParser &parser) {
+        Blackboard::Viewport view = blackboard.getViewport();
+        if (view.columns == 0 && id != CommandId::VIEW) {
+            view = {0, 0, Blackboard::defaultViewColumns, Blackboard::defaultViewRows, 1};
+        }
+
+        int a, b;
+        if (id == CommandId::VIEW && parser.next(a) && parser.next(b) && a > 0 && b > 0) {
+            view.columns = a;
+            view.rows = b;
+        } else if (id == CommandId::VIEW && parser.next() == "off") {
+            view.columns = 0;
+        } else if (id == CommandId::PAN && parser.next(a) && parser.next(b)) {
+            view.x = clampToInt(view.x + static_cast<long long>(a) * view.zoom);
+            view.y = clampToInt(view.y + static_cast<long long>(b) * view.zoom);
+        } else if (id == CommandId::ZOOM && parser.next(a) && a > 0) {
+            // Keep the centre of the view where it is.
+            long long centreX = view.x + static_cast<long long>(view.columns) * view.zoom / 2;
+            long long centreY = view.y + static_cast<long long>(view.rows) * view.zoom / 2;
+            view.zoom = a;
+            view.x = clampToInt(centreX - static_cast<long long>(view.columns) * a / 2);
+            view.y = clampToInt(centreY - static_cast<long long>(view.rows) * a / 2);
+        } else if (id != CommandId::VIEW) {
+            std::cout << "Invalid parameters for " << (id == CommandId::PAN ? "pan" : "zoom") << ".\n";
+            return;
+        }
+        blackboard.setViewport(view);
+
+        view = blackboard.getViewport();
+        if (view.columns == 0) {
+            std::cout << "Showing the whole board.\n";
+        } else {
+            std::cout << "Showing " << view.columns << 'x' << view.rows << " cells from (" << view.x << ", " << view.y
+                      << ") at zoom " << view.zoom << ".\n";
+        }
+    }
+}
 
 CLI::CLI(Blackboard &b) : blackboard(b) {};
 
 void CLI::run() {
     std::string command;
     printHelp();
-    blackboard.save("temp" + std::to_string(action));
+
+    // Only large files are worth a progress line; scripts and piped input stay quiet.
+    blackboard.setLoadProgress([shown = -1](std::uint64_t done, std::uint64_t total) mutable {
+        if (total < progressMinBytes) return;
+        int percent = static_cast<int>(done * 100 / total);
+        if (percent == shown) return;
+        shown = percent == 100 ? -1 : percent;
+        std::cout << "\rLoading... " << percent << '%' << (percent == 100 ? "\n" : "") << std::flush;
+    });
     while (true) {
         std::cout << ">";
-        std::getline(std::cin, command);
+        if (!std::getline(std::cin, command)) break;
         if (command.empty()) continue;
         if (command == "exit") break;
         processCommand(command);
     }
 }
 
-void CLI::processCommand(const std::string &command) {
+bool CLI::runScript(std::string_view script) {
+    if (scriptDepth >= maxScriptDepth) {
+        std::cout << "Scripts are nested too deeply.\n";
+        return true;
+    }
+    {
+        std::lock_guard<std::recursive_mutex> lock(sceneMutex);
+        blackboard.beginBatch();
+    }
+    ++scriptDepth;
+
+    bool exited = false;
+    while (!script.empty() && !exited) {
+        std::size_t end = std::min(script.find('\n'), script.size());
+        std::string_view command = script.substr(0, end);
+        script.remove_prefix(std::min(end + 1, script.size()));
+
+        if (!command.empty() && command.back() == '\r') command.remove_suffix(1);
+        if (command.empty() || command[0] == '#') continue;
+        if (command == "exit") {
+            exited = true;
+        } else {
+            processCommand(command);
+        }
+    }
+
+    --scriptDepth;
+    {
+        std::lock_guard<std::recursive_mutex> lock(sceneMutex);
+        blackboard.endBatch();
+    }
+    return !exited;
+}
+
+bool CLI::runScriptFile(const std::string &filePath) {
+    try {
+        MappedFile file(filePath);
+        return runScript({reinterpret_cast<const char *>(file.data()), file.size()});
+    } catch (const std::exception &e) {
+        std::cerr << "Failed to run script: " << e.what() << '\n';
+        return true;
+    }
+}
+
+void CLI::enableAutosave(const std::string &filePath, std::chrono::milliseconds interval) {
+    autosaver = std::make_unique<Autosaver>(filePath, interval, [this] {
+        std::lock_guard<std::recursive_mutex> lock(sceneMutex);
+        return blackboard.snapshot();
+    });
+}
+
+void CLI::processCommand(std::string_view command) {
+    std::lock_guard<std::recursive_mutex> lock(sceneMutex);
+    if (executeCommand(command) && autosaver) {
+        autosaver->notifyChanged();
+    }
+}
+
+bool CLI::executeCommand(std::string_view command) {
     bool change = false;
-    std::istringstream iss(command);
-    std::string cmd;
-    iss >> cmd;
-
-    if (cmd == "draw") {
-        blackboard.draw();
-    } else if (cmd == "list") {
-        blackboard.listShapes();
-    } else if (cmd == "shapes") {
-        printAvailableShapes();
-    } else if (cmd == "add") {
-        change = addShape(iss);
-    } else if (cmd == "remove") {
-        int shapeId;
-        iss >> shapeId;
-        change = blackboard.removeShape();
-    } else if (cmd == "undo") {
-        if (action > 0) {
-            action--;
-            blackboard.load("temp"+std::to_string(action));
-            std::cout << "Reverted previous change." << std::endl;
-        } else std::cout<<"No more changes to revert."<<std::endl;
-    } else if (cmd == "clear") {
-        change = blackboard.clear();
-    } else if (cmd == "select") {
-        std::vector<int> params;
-        int param;
-        while (iss >> param) {
-            params.push_back(param);
+    CommandParser parser(command);
+    std::string_view cmd = parser.next();
+    CommandId id = lookupCommand(cmd);
+#if BLACKBOARD_STATS
+    auto start = std::chrono::steady_clock::now();
+#endif
+
+    switch (id) {
+        case CommandId::DRAW:
+            blackboard.draw();
+            break;
+        case CommandId::LIST:
+            blackboard.listShapes();
+            break;
+        case CommandId::SHAPES:
+            printAvailableShapes();
+            break;
+        case CommandId::ADD:
+            change = addShape(parser);
+            break;
+        case CommandId::REMOVE:
+            change = blackboard.removeShape();
+            break;
+        case CommandId::UNDO:
+            change = blackboard.undo();
+            if (change) std::cout << "Reverted previous change.\n";
+            else std::cout << "No more changes to revert.\n";
+            break;
+        case CommandId::REDO:
+            change = blackboard.redo();
+            if (change) std::cout << "Restored reverted change.\n";
+            else std::cout << "No more changes to restore.\n";
+            break;
+        case CommandId::CLEAR:
+            change = blackboard.clear();
+            break;
+        case CommandId::SELECT: {
+            int params[3];
+            std::size_t count = 0;
+            while (count < 3 && parser.next(params[count])) ++count;
+            if (count == 1) {
+                blackboard.selectId(params[0]);
+            } else if (count == 2) {
+                blackboard.selectPosition(params[0], params[1]);
+            } else {
+                std::cout << "Invalid amount of arguments.\n";
+            }
+            break;
         }
-        if (params.size() == 1) {
-            blackboard.selectId(params[0]);
-        } else if (params.size() == 2) {
-            blackboard.selectPosition(params[0], params[1]);
-        } else {
-            std::cout << "Invalid amount of arguments." << std::endl;
+        case CommandId::EDIT: {
+            float values[maxParams + 1];
+            std::size_t count = 0;
+            while (count <= maxParams && parser.next(values[count])) ++count;
+            if (count <= maxParams && !parser.atEnd()) {
+                std::cout << "Invalid number: " << parser.next() << ".\n";
+            } else if (count > maxParams) {
+                std::cout << "Invalid amount of arguments.\n";
+            } else {
+                change = blackboard.editParams(values, count);
+            }
+            break;
         }
-    } else if (cmd == "edit") {
-        float value;
-        std::vector<float> values;
-        while (iss >> value) {
-            values.push_back(value);
+        case CommandId::MOVE: {
+            int x, y;
+            if (parser.next(x) && parser.next(y)) {
+                change = blackboard.editPosition(x, y);
+            } else {
+                std::cout << "Invalid amount of arguments.\n";
+            }
+            break;
         }
-        change = blackboard.editParams(values);
-    } else if (cmd == "move") {
-        int x, y;
-        iss >> x >> y;
-        change = blackboard.editPosition(x, y);
-    } else if (cmd == "paint") {
-        char colour;
-        iss >> colour;
-        change = blackboard.editColour(colour);
-    } else if (cmd == "save") {
-        std::string filePath;
-        iss >> filePath;
-        if (blackboard.save(filePath)) std::cout << "Blackboard saved to " << filePath << std::endl;
-    } else if (cmd == "load") {
-        std::string filePath;
-        iss >> filePath;
-        change = blackboard.load(filePath);
-        if (change) std::cout << "Blackboard loaded from " << filePath << std::endl;
-    } else if (cmd == "help") {
-        printHelp();
-    } else {
-        std::cout << "Unknown command: " << cmd << std::endl;
-    }
-    if (change) {
-        action++;
-        blackboard.save("temp" + std::to_string(action));
+        case CommandId::PAINT: {
+            char colour;
+            if (parser.next(colour)) {
+                change = blackboard.editColour(colour);
+            } else {
+                std::cout << "Invalid amount of arguments.\n";
+            }
+            break;
+        }
+        case CommandId::SAVE: {
+            std::string filePath(parser.next());
+            std::string_view formatName = parser.next();
+            SceneFormat format = SceneFile::formatFor(filePath);
+            if (formatName == "binary") format = SceneFormat::BINARY;
+            else if (formatName == "text") format = SceneFormat::TEXT;
+            if (blackboard.save(filePath, format)) std::cout << "Blackboard saved to " << filePath << '\n';
+            break;
+        }
+        case CommandId::LOAD: {
+            std::string filePath(parser.next());
+            change = blackboard.load(filePath);
+            if (change) std::cout << "Blackboard loaded from " << filePath << '\n';
+            break;
+        }
+        case CommandId::EXPORT: {
+            std::string filePath(parser.next());
+            if (blackboard.exportImage(filePath)) std::cout << "Blackboard exported to " << filePath << '\n';
+            break;
+        }
+        case CommandId::THREADS: {
+            int threads;
+            if (parser.next(threads) && threads >= 0) blackboard.setRenderThreads(static_cast<unsigned>(threads));
+            std::cout << "Rendering on " << blackboard.getRenderThreads() << " thread(s).\n";
+            break;
+        }
+        case CommandId::LAYER: {
+            std::string_view name = parser.next();
+            if (name.empty()) {
+                blackboard.listLayers();
+            } else {
+                blackboard.useLayer(std::string(name));
+            }
+            break;
+        }
+        case CommandId::VIEW:
+        case CommandId::PAN:
+        case CommandId::ZOOM:
+            changeView(blackboard, id, parser);
+            break;
+        case CommandId::STATS:
+            if (parser.next() == "reset") {
+                Stats::reset();
+                std::cout << "Statistics reset.\n";
+            } else {
+                Stats::print(std::cout);
+            }
+            break;
+        case CommandId::RUN:
+            runScriptFile(std::string(parser.next()));
+            break;
+        case CommandId::HELP:
+            printHelp();
+            break;
+        case CommandId::UNKNOWN:
+            std::cout << "Unknown command: " << cmd << '\n';
+            break;
     }
+#if BLACKBOARD_STATS
+    if (id != CommandId::UNKNOWN) Stats::recordCommand(cmd, std::chrono::steady_clock::now() - start);
+#endif
+    return change;
 }
 
 void CLI::printHelp() const {
@@ -95,61 +377,55 @@ void CLI::printHelp() const {
                  "\tlist                         - Print all added shapes with their IDs and parameters.\n"
                  "\tshapes                       - Print a list of all available shapes and parameters for add call.\n"
                  "\tadd <shape> <parameters>     - Add shape to the blackboard.\n"
-                 "\tundo                         - Remove the last added shape from the blackboard.\n"
+                 "\tundo                         - Revert the last change.\n"
+                 "\tredo                         - Restore the last reverted change.\n"
                  "\tclear                        - Remove all shapes from the blackboard.\n"
                  "\tselect <id|position>         - Select shape by id or position.\n"
                  "\tedit <parameters>            - Edit shape parameters.\n"
                  "\tmove <x> <y>                 - Move shape to new coordinates.\n"
                  "\tpaint <colour>               - Paint shape new colour.\n"
-                 "\tsave <file-path>             - Save the blackboard to the file.\n"
-                 "\tload <file-path>             - Load a blackboard from the file.\n"
+                 "\tsave <file-path> [format]    - Save the blackboard as text or binary (binary by default for .sbb).\n"
+                 "\tload <file-path>             - Load a blackboard from a text or binary file.\n"
+                 "\texport <file-path>           - Write the board as a PPM image, or PGM for a .pgm path.\n"
+                 "\trun <script-path>            - Run the commands in a file as one undoable step.\n"
+                 "\tthreads [count]              - Show or set the number of render threads.\n"
+                 "\tlayer [name]                 - List layers, or draw on a layer, adding it on top if new.\n"
+                 "\tview [<columns> <rows>|off]  - Show or set the part of the board draw shows.\n"
+                 "\tpan <dx> <dy>                - Move the view by screen cells.\n"
+                 "\tzoom <level>                 - Show level x level board cells per screen cell.\n"
+                 "\tstats [reset]                - Show or reset timings and counters.\n"
                  "\thelp                         - Show this help message.\n"
                  "\texit                         - Exit.\n";
 }
 
 void CLI::printAvailableShapes() const {
     std::cout << "Available shapes:\n";
-    std::cout << "\trectangle <x> <y> <colour> <fill/frame> <width> <height>\n";
-    std::cout << "\tcircle <x> <y> <colour> <fill/frame> <radius>\n";
-    std::cout << "\ttriangle <x> <y> <colour> <fill/frame> <height> <width>\n";
-    std::cout << "\tline <x> <y> <colour> <length> <angle>\n";
+    for (std::uint8_t tag = 1; tag <= ShapeRegistry::count; ++tag) {
+        std::cout << '\t';
+        ShapeRegistry::writeUsage(std::cout, ShapeRegistry::kindOf(tag));
+        std::cout << '\n';
+    }
 }
 
-bool CLI::addShape(std::istringstream &iss) {
-    int x, y;
-    std::string shapeType, fillOrFrame;
-    iss >> shapeType;
-
-    if (shapeType == "rectangle") {
-        int width, height;
-        char colour;
-        iss >> x >> y >> colour >> fillOrFrame >> width >> height;
-        bool fillMode = (fillOrFrame == "fill") ? 1 : 0;
-        blackboard.addShape(std::make_shared<SRectangle>(x, y, colour, fillMode, width, height));
-        return true;
-    } else if (shapeType == "circle") {
-        int radius;
-        char colour;
-        iss >> x >> y >> colour >> fillOrFrame >> radius;
-        bool fillMode = (fillOrFrame == "fill") ? 1 : 0;
-        blackboard.addShape(std::make_shared<Circle>(x, y, colour, fillMode, radius));
-        return true;
-    } else if (shapeType == "triangle") {
-        int height, width;
-        char colour;
-        iss >> x >> y >> colour >> fillOrFrame >> height >> width;
-        bool fillMode = (fillOrFrame == "fill") ? 1 : 0;
-        blackboard.addShape(std::make_shared<Triangle>(x, y, colour, fillMode, height, width));
-        return true;
-    } else if (shapeType == "line") {
-        int length;
-        double angle;
-        char colour;
-        bool fillMode;
-        iss >> x >> y >> colour >> length >> angle;
-        blackboard.addShape(std::make_shared<Line>(x, y, colour, fillMode, length, angle));
-        return true;
+bool CLI::addShape(CommandParser &parser) {
+    std::string_view shapeType = parser.next();
+    const ShapeKind *kind = ShapeRegistry::findCommand(shapeType);
+    if (!kind) {
+        std::cout << "Unknown shape type: " << shapeType << '\n';
+        return false;
+    }
+
+    ShapeRecord record{};
+    record.tag = kind->tag;
+    bool placed = parser.next(record.x) && parser.next(record.y) && parser.next(record.colour);
+    record.fillMode = kind->hasFill && parser.next() == "fill";
+    if (!placed || !ShapeRegistry::parseParams(parser, record)) {
+        std::cout << "Invalid parameters for " << shapeType << ".\n";
+        return false;
+    }
+    if (const ShapeParam *invalid = ShapeRegistry::invalidParam(record)) {
+        std::cout << "Invalid " << invalid->name << " for " << kind->name << ".\n";
+        return false;
     }
-    std::cout << "Unknown shape type: " << shapeType << std::endl;
-    return false;
+    return blackboard.addShape(ShapeRegistry::make(record));
 }
@@ -1,10 +1,16 @@
 #ifndef CLI_H
 #define CLI_H
 
+#include <chrono>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
-#include <sstream>
+#include <string_view>
+#include "Autosaver.h"
 #include "Blackboard.h"
+#include "CommandParser.h"
 
 class CLI {
 private:
@@ -15,18 +21,40 @@ public:
 
     void run();
 
+    // Runs each line of script as a command, in one batch: the changes undo as a single step and
+    // nothing is drawn unless the script says so. Blank lines and lines starting with '#' are
+    // skipped. Returns false if the script ended with exit.
+    bool runScript(std::string_view script);
+
+    bool runScriptFile(const std::string &filePath);
+
+    void enableAutosave(const std::string &filePath, std::chrono::milliseconds interval);
+
 private:
-    void processCommand(const std::string &command);
+    static constexpr int maxScriptDepth = 16;
+
+    static constexpr std::uint64_t progressMinBytes = 64 << 20;
+
+    // Most numbers any command takes; they are parsed into a buffer on the stack.
+    static constexpr std::size_t maxParams = 4;
+
+    int scriptDepth = 0;
+
+    void processCommand(std::string_view command);
+
+    // Runs one command and reports whether it changed the scene. The caller holds sceneMutex.
+    bool executeCommand(std::string_view command);
 
     void printAvailableShapes() const;
 
-    bool addShape(std::istringstream &iss);
+    bool addShape(CommandParser &parser);
 
     void printHelp() const;
 
-    void undo();
-
-    int action = 0;
+    // Held while a command runs; the autosaver takes it only to copy the shape pointers. Recursive
+    // because the run command executes a script from inside a command.
+    std::recursive_mutex sceneMutex;
+    std::unique_ptr<Autosaver> autosaver;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include "CommandParser.h"
+
+namespace {
+    bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+    }
+
+    // from_chars takes no leading '+', the old stream parsing did.
+    std::string_view withoutPlus(std::string_view token) {
+        if (token.size() > 1 && token[0] == '+') token.remove_prefix(1);
+        return token;
+    }
+
+    template<typename T>
+    bool parseNumber(std::string_view token, T &value) {
+        token = withoutPlus(token);
+        if (token.empty()) return false;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+        auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+        // from_chars also reads "nan", "inf" and "infinity", which no size or angle can be.
+        return result.ec == std::errc() && result.ptr == token.data() + token.size() && std::isfinite(value);
+#else
+        // Standard libraries without floating-point from_chars: strtod on a stack copy.
+        char buffer[64];
+        if (token.size() >= sizeof(buffer)) return false;
+        std::memcpy(buffer, token.data(), token.size());
+        buffer[token.size()] = '\0';
+        char *end;
+        double parsed = std::strtod(buffer, &end);
+        if (end != buffer + token.size()) return false;
+        value = static_cast<T>(parsed);
+        return std::isfinite(value);
+#endif
+    }
+
+    bool parseNumber(std::string_view token, int &value) {
+        token = withoutPlus(token);
+        auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+        return !token.empty() && result.ec == std::errc() && result.ptr == token.data() + token.size();
+    }
+}
+
+std::string_view CommandParser::peek() const {
+    std::size_t start = 0;
+    while (start < rest.size() && isSpace(rest[start])) ++start;
+    std::size_t end = start;
+    while (end < rest.size() && !isSpace(rest[end])) ++end;
+    return rest.substr(start, end - start);
+}
+
+std::string_view CommandParser::next() {
+    std::string_view token = peek();
+    rest.remove_prefix(token.data() - rest.data() + token.size());
+    return token;
+}
+
+bool CommandParser::next(int &value) {
+    if (!parseNumber(peek(), value)) return false;
+    next();
+    return true;
+}
+
+bool CommandParser::next(float &value) {
+    if (!parseNumber(peek(), value)) return false;
+    next();
+    return true;
+}
+
+bool CommandParser::next(double &value) {
+    if (!parseNumber(peek(), value)) return false;
+    next();
+    return true;
+}
+
+bool CommandParser::next(char &value) {
+    std::string_view token = next();
+    if (token.empty()) return false;
+    value = token[0];
+    return true;
+}
+
+bool CommandParser::atEnd() const {
+    return peek().empty();
+}
@@ -0,0 +1,34 @@
+#ifndef COMMANDPARSER_H
+#define COMMANDPARSER_H
+
+#include <string_view>
+
+// Splits one command line into whitespace-separated tokens, in place. Tokens are views into the
+// line and numbers are parsed with std::from_chars, so nothing is allocated. A number getter
+// fails, without consuming anything, when the next token is missing or not entirely a finite
+// number.
+class CommandParser {
+private:
+    std::string_view rest;
+
+    std::string_view peek() const;
+
+public:
+    explicit CommandParser(std::string_view line) : rest(line) {}
+
+    // The next token, or an empty view at the end of the line.
+    std::string_view next();
+
+    bool next(int &value);
+
+    bool next(float &value);
+
+    bool next(double &value);
+
+    // First character of the next token.
+    bool next(char &value);
+
+    bool atEnd() const;
+};
+
+#endif
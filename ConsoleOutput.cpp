@@ -0,0 +1,124 @@
+#include <cerrno>
+#include <iostream>
+#include "ConsoleOutput.h"
+#include "Simd.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+AnsiConsole::AnsiConsole() {
+#ifdef _WIN32
+    HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode = 0;
+    if (GetConsoleMode(hConsole, &mode)) {
+        SetConsoleMode(hConsole, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+    }
+#endif
+}
+
+AnsiConsole::Colour AnsiConsole::getCharColour(char colourChar) {
+    switch (colourChar) {
+        case 'k':
+            return BLACK;
+        case 'b':
+            return BLUE;
+        case 'g':
+            return GREEN;
+        case 'r':
+            return RED;
+        case 'y':
+            return YELLOW;
+        default:
+            return WHITE;
+    }
+}
+
+const char *AnsiConsole::escapeFor(Colour colour) {
+    switch (colour) {
+        case BLACK:
+            return "\x1b[30m";
+        case BLUE:
+            return "\x1b[34m";
+        case GREEN:
+            return "\x1b[32m";
+        case RED:
+            return "\x1b[31m";
+        case YELLOW:
+            return "\x1b[33m";
+        default:
+            return "\x1b[0m";
+    }
+}
+
+void AnsiConsole::encodeRow(const char *cells, int width, std::string &line) {
+    line.clear();
+    Colour current = WHITE;
+    char last = ' ';
+    std::size_t count = static_cast<std::size_t>(width);
+
+    for (std::size_t i = 0; i < count;) {
+        // Blanks and repeats of the last symbol never need an escape, so a whole run is copied at once.
+        std::size_t run = Simd::runLength(cells + i, count - i, ' ', last);
+        if (run > 0) {
+            std::size_t end = line.size();
+            line.resize(end + 2 * run);
+            Simd::expandCells(cells + i, run, &line[end]);
+            i += run;
+            continue;
+        }
+
+        char symbol = cells[i];
+        Colour colour = getCharColour(symbol);
+        if (colour != current) {
+            line += escapeFor(colour);
+            current = colour;
+        }
+        line += symbol;
+        line += ' ';
+        last = symbol;
+        ++i;
+    }
+    if (current != WHITE) line += escapeFor(WHITE);
+    line += '\n';
+}
+
+void AnsiConsole::writeAll(const std::string &bytes) {
+    const char *data = bytes.data();
+    std::size_t left = bytes.size();
+
+    while (left > 0) {
+#ifdef _WIN32
+        DWORD written = 0;
+        if (!WriteFile(GetStdHandle(STD_OUTPUT_HANDLE), data, static_cast<DWORD>(left), &written, nullptr)) return;
+#else
+        ssize_t written = ::write(STDOUT_FILENO, data, left);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+#endif
+        data += written;
+        left -= static_cast<std::size_t>(written);
+    }
+}
+
+void AnsiConsole::present(const Framebuffer &board, const std::vector<bool> &changedRows) {
+    int height = board.getHeight();
+    bool cacheValid = rowCache.size() == static_cast<std::size_t>(height);
+    rowCache.resize(height);
+
+    frame.clear();
+    for (int i = 0; i < height; ++i) {
+        if (!cacheValid || changedRows[i]) {
+            encodeRow(board.row(i), board.getWidth(), rowCache[i]);
+        }
+        frame += rowCache[i];
+    }
+
+    // Anything still buffered in std::cout belongs before the frame.
+    std::cout.flush();
+    writeAll(frame);
+}
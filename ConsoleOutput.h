@@ -0,0 +1,39 @@
+#ifndef CONSOLEOUTPUT_H
+#define CONSOLEOUTPUT_H
+
+#include <string>
+#include <vector>
+#include "FrameSink.h"
+
+// ANSI/VT terminal output. Each row is encoded once into a cached line that starts and ends in the
+// default colour, so unchanged rows are reused verbatim, and the frame goes out in a single write.
+class AnsiConsole : public FrameSink {
+private:
+    enum Colour {
+        BLACK,
+        BLUE,
+        GREEN,
+        RED,
+        YELLOW,
+        WHITE
+    };
+
+    std::vector<std::string> rowCache;
+    std::string frame;
+
+    static Colour getCharColour(char colourChar);
+
+    static const char *escapeFor(Colour colour);
+
+    static void writeAll(const std::string &bytes);
+
+public:
+    AnsiConsole();
+
+    // The bytes present() emits for one row of cells.
+    static void encodeRow(const char *cells, int width, std::string &line);
+
+    void present(const Framebuffer &board, const std::vector<bool> &changedRows) override;
+};
+
+#endif
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include "FrameSink.h"
+#include "RaiiWrapper.h"
+#include "Stats.h"
+
+namespace {
+    struct Rgb {
+        unsigned char r, g, b;
+    };
+
+    // The colour letters AnsiConsole understands; anything else is drawn in the default white.
+    Rgb cellColour(char cell) {
+        switch (cell) {
+            case ' ':
+                return {24, 24, 24};
+            case 'k':
+                return {0, 0, 0};
+            case 'b':
+                return {0, 0, 205};
+            case 'g':
+                return {0, 205, 0};
+            case 'r':
+                return {205, 0, 0};
+            case 'y':
+                return {205, 205, 0};
+            default:
+                return {229, 229, 229};
+        }
+    }
+
+    unsigned char luminance(Rgb colour) {
+        return static_cast<unsigned char>((299 * colour.r + 587 * colour.g + 114 * colour.b) / 1000);
+    }
+
+    char *putPixel(char *pixel, char cell, bool colour) {
+        Rgb rgb = cellColour(cell);
+        if (colour) {
+            *pixel++ = static_cast<char>(rgb.r);
+            *pixel++ = static_cast<char>(rgb.g);
+            *pixel++ = static_cast<char>(rgb.b);
+        } else {
+            *pixel++ = static_cast<char>(luminance(rgb));
+        }
+        return pixel;
+    }
+
+    std::string imageHeader(int width, int height, bool colour) {
+        return (colour ? "P6\n" : "P5\n") + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+    }
+
+    bool sameSize(const Framebuffer &a, const Framebuffer &b) {
+        return a.getWidth() == b.getWidth() && a.getHeight() == b.getHeight();
+    }
+
+    void copyRow(Framebuffer &to, const Framebuffer &from, int y) {
+        std::memcpy(to.row(y), from.row(y), static_cast<std::size_t>(from.getWidth()));
+    }
+}
+
+void NullSink::present(const Framebuffer &, const std::vector<bool> &) {
+    ++frames;
+}
+
+void MemorySink::present(const Framebuffer &board, const std::vector<bool> &changedRows) {
+    bool resized = !sameSize(copy, board);
+    if (resized) copy.resize(board.getWidth(), board.getHeight());
+
+    for (int y = 0; y < board.getHeight(); ++y) {
+        if (resized || changedRows[y]) copyRow(copy, board, y);
+    }
+    ++frames;
+}
+
+ImageSink::ImageSink(std::string filePath, ImageFormat format) : filePath(std::move(filePath)), format(format) {}
+
+void ImageSink::present(const Framebuffer &board, const std::vector<bool> &) {
+    try {
+        write(board, filePath, format);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+    }
+}
+
+ImageFormat ImageSink::formatFor(const std::string &filePath) {
+    const std::string extension = ".pgm";
+    bool grey = filePath.size() >= extension.size() &&
+                filePath.compare(filePath.size() - extension.size(), extension.size(), extension) == 0;
+    return grey ? ImageFormat::PGM : ImageFormat::PPM;
+}
+
+void ImageSink::write(const Framebuffer &board, const std::string &filePath, ImageFormat format) {
+    int width = board.getWidth(), height = board.getHeight();
+    bool colour = format == ImageFormat::PPM;
+
+    std::string image = imageHeader(width, height, colour);
+    std::size_t header = image.size();
+    image.resize(header + static_cast<std::size_t>(width) * height * (colour ? 3 : 1));
+
+    char *pixel = &image[header];
+    for (int y = 0; y < height; ++y) {
+        const char *cells = board.row(y);
+        for (int x = 0; x < width; ++x) {
+            pixel = putPixel(pixel, cells[x], colour);
+        }
+    }
+
+    RaiiWrapper file(filePath, true, true);
+    file.getOutputStream().write(image.data(), static_cast<std::streamsize>(image.size()));
+    if (!file.getOutputStream()) {
+        throw std::runtime_error("Error writing image: " + filePath);
+    }
+    STATS_ADD(FILE_BYTES_WRITTEN, image.size());
+}
+
+void ImageSink::write(const TiledFramebuffer &board, const std::string &filePath, ImageFormat format) {
+    int width = board.getWidth(), height = board.getHeight(), tileSize = TiledFramebuffer::tileSize;
+    bool colour = format == ImageFormat::PPM;
+    std::size_t depth = colour ? 3 : 1;
+
+    // Rows go out one at a time: a blank row with the tiles crossing it painted in, and blanked
+    // again after writing, so the image is never held whole and only the tiles are converted.
+    std::vector<char> blankRow(static_cast<std::size_t>(width) * depth), row;
+    for (std::size_t x = 0; x < blankRow.size(); x += depth) {
+        putPixel(&blankRow[x], ' ', colour);
+    }
+    row = blankRow;
+    std::vector<TiledFramebuffer::Tile> tiles = board.allocatedTiles();
+
+    RaiiWrapper file(filePath, true, true);
+    std::ostream &out = file.getOutputStream();
+    std::string header = imageHeader(width, height, colour);
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+    auto first = tiles.begin(), last = tiles.begin();
+    for (int y = 0; y < height; ++y) {
+        if (y % tileSize == 0) {
+            first = last;
+            while (last != tiles.end() && last->y == y) ++last;
+        }
+        for (auto tile = first; tile != last; ++tile) {
+            const char *cells = tile->cells + static_cast<std::size_t>(y - tile->y) * tileSize;
+            char *pixel = &row[static_cast<std::size_t>(tile->x) * depth];
+            for (int x = 0; x < std::min(tileSize, width - tile->x); ++x) {
+                pixel = putPixel(pixel, cells[x], colour);
+            }
+        }
+        out.write(row.data(), static_cast<std::streamsize>(row.size()));
+        for (auto tile = first; tile != last; ++tile) {
+            std::size_t offset = static_cast<std::size_t>(tile->x) * depth;
+            std::size_t bytes = static_cast<std::size_t>(std::min(tileSize, width - tile->x)) * depth;
+            std::memcpy(&row[offset], &blankRow[offset], bytes);
+        }
+    }
+
+    if (!out) {
+        throw std::runtime_error("Error writing image: " + filePath);
+    }
+    STATS_ADD(FILE_BYTES_WRITTEN, header.size() + static_cast<std::uint64_t>(width) * height * depth);
+}
+
+DiffSink::DiffSink(std::unique_ptr<FrameSink> next) : next(std::move(next)) {}
+
+void DiffSink::present(const Framebuffer &board, const std::vector<bool> &changedRows) {
+    int width = board.getWidth(), height = board.getHeight();
+    bool everything = !hasPrevious || !sameSize(previous, board);
+    if (everything) previous.resize(width, height);
+
+    differentRows.assign(height, false);
+    cells = 0;
+    bounds = {0, 0, -1, -1};
+    for (int y = 0; y < height; ++y) {
+        if (!everything && !changedRows[y]) continue;
+
+        const char *now = board.row(y);
+        const char *before = previous.row(y);
+        if (!everything && std::memcmp(now, before, static_cast<std::size_t>(width)) == 0) continue;
+
+        int first = width, last = -1;
+        for (int x = 0; x < width; ++x) {
+            if (everything || now[x] != before[x]) {
+                ++cells;
+                if (first == width) first = x;
+                last = x;
+            }
+        }
+        if (last < 0) continue;
+
+        differentRows[y] = true;
+        bounds = bounds.unite({first, y, last, y});
+        copyRow(previous, board, y);
+    }
+    hasPrevious = true;
+
+    if (next) next->present(board, differentRows);
+}
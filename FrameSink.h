@@ -0,0 +1,110 @@
+#ifndef FRAMESINK_H
+#define FRAMESINK_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Framebuffer.h"
+#include "TiledFramebuffer.h"
+
+// Consumes rendered frames. Rendering only fills a Framebuffer; what happens to the frame next, if
+// anything, is up to the sink, so the board can run without a terminal.
+class FrameSink {
+public:
+    virtual ~FrameSink() = default;
+
+    // Takes the whole board. changedRows marks the rows whose cells may differ from the previous frame
+    // this sink was given; every row of the first frame and of a resized one counts as changed.
+    virtual void present(const Framebuffer &board, const std::vector<bool> &changedRows) = 0;
+};
+
+// Drops every frame; for render-only runs.
+class NullSink : public FrameSink {
+private:
+    std::size_t frames = 0;
+
+public:
+    void present(const Framebuffer &board, const std::vector<bool> &changedRows) override;
+
+    std::size_t frameCount() const {
+        return frames;
+    }
+};
+
+// Keeps a copy of the latest frame, copying only the rows marked as changed.
+class MemorySink : public FrameSink {
+private:
+    Framebuffer copy{0, 0};
+    std::size_t frames = 0;
+
+public:
+    void present(const Framebuffer &board, const std::vector<bool> &changedRows) override;
+
+    const Framebuffer &frame() const {
+        return copy;
+    }
+
+    std::size_t frameCount() const {
+        return frames;
+    }
+};
+
+enum class ImageFormat {
+    PPM,
+    PGM
+};
+
+// Writes each frame to a binary PPM (colour) or PGM (grey) file, one pixel per cell, replacing the
+// file every time. Cells take the terminal's colours; blanks are the dark board.
+class ImageSink : public FrameSink {
+private:
+    std::string filePath;
+    ImageFormat format;
+
+public:
+    ImageSink(std::string filePath, ImageFormat format);
+
+    void present(const Framebuffer &board, const std::vector<bool> &changedRows) override;
+
+    // PGM for a .pgm path, PPM otherwise.
+    static ImageFormat formatFor(const std::string &filePath);
+
+    // Throws std::runtime_error if the file cannot be written.
+    static void write(const Framebuffer &board, const std::string &filePath, ImageFormat format);
+
+    // Same image from a tiled board, streamed out a row at a time.
+    static void write(const TiledFramebuffer &board, const std::string &filePath, ImageFormat format);
+};
+
+// Compares each frame with the one before it, cell by cell, and passes it on to next (if any) with
+// only the rows that really differ marked. Rows not marked as changed are taken as equal unseen.
+class DiffSink : public FrameSink {
+private:
+    std::unique_ptr<FrameSink> next;
+    Framebuffer previous{0, 0};
+    bool hasPrevious = false;
+    std::vector<bool> differentRows;
+    std::size_t cells = 0;
+    Rect bounds{0, 0, -1, -1};
+
+public:
+    explicit DiffSink(std::unique_ptr<FrameSink> next = nullptr);
+
+    void present(const Framebuffer &board, const std::vector<bool> &changedRows) override;
+
+    // Cells that differ between the last two frames, and the smallest rectangle holding them.
+    std::size_t changedCells() const {
+        return cells;
+    }
+
+    Rect changedBounds() const {
+        return bounds;
+    }
+
+    const std::vector<bool> &changedRows() const {
+        return differentRows;
+    }
+};
+
+#endif
@@ -0,0 +1,34 @@
+#include <cstring>
+#include "Framebuffer.h"
+
+Framebuffer::Framebuffer(int w, int h, char fill) : width(0), height(0), stride(0) {
+    resize(w, h, fill);
+}
+
+void Framebuffer::resize(int w, int h, char fill) {
+    width = w > 0 ? w : 0;
+    height = h > 0 ? h : 0;
+    stride = (static_cast<std::size_t>(width) + alignment - 1) / alignment * alignment;
+
+    std::size_t bytes = stride * static_cast<std::size_t>(height);
+    cells.reset(bytes ? static_cast<char *>(::operator new[](bytes, std::align_val_t(alignment))) : nullptr);
+    this->fill(fill);
+}
+
+void Framebuffer::fill(char symbol) {
+    if (cells) {
+        std::memset(cells.get(), symbol, stride * static_cast<std::size_t>(height));
+    }
+}
+
+void Framebuffer::fillSpans(const std::vector<Span> &spans, char symbol) {
+    for (const auto &span: spans) {
+        fillSpan(span, symbol);
+    }
+}
+
+void Framebuffer::fillRect(const Rect &area, char symbol) {
+    for (int y = area.y0; y <= area.y1; ++y) {
+        Simd::fill(row(y) + area.x0, symbol, static_cast<std::size_t>(area.x1 - area.x0 + 1));
+    }
+}
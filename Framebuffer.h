@@ -0,0 +1,89 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+#include "Geometry.h"
+#include "Simd.h"
+
+class Framebuffer {
+private:
+    static constexpr std::size_t alignment = 64;
+
+    struct AlignedDeleter {
+        void operator()(char *p) const {
+            ::operator delete[](p, std::align_val_t(alignment));
+        }
+    };
+
+    int width, height;
+    std::size_t stride;
+    std::unique_ptr<char[], AlignedDeleter> cells;
+
+public:
+    Framebuffer(int w, int h, char fill = ' ');
+
+    void resize(int w, int h, char fill = ' ');
+
+    void fill(char symbol);
+
+    int getWidth() const {
+        return width;
+    }
+
+    int getHeight() const {
+        return height;
+    }
+
+    std::size_t getStride() const {
+        return stride;
+    }
+
+    char *data() {
+        return cells.get();
+    }
+
+    const char *data() const {
+        return cells.get();
+    }
+
+    char *row(int y) {
+        return cells.get() + static_cast<std::size_t>(y) * stride;
+    }
+
+    const char *row(int y) const {
+        return cells.get() + static_cast<std::size_t>(y) * stride;
+    }
+
+    char *span(int y, int x) {
+        return row(y) + x;
+    }
+
+    const char *span(int y, int x) const {
+        return row(y) + x;
+    }
+
+    char &at(int x, int y) {
+        return row(y)[x];
+    }
+
+    char at(int x, int y) const {
+        return row(y)[x];
+    }
+
+    void fillSpan(const Span &span, char symbol) {
+        Simd::fill(row(span.y) + span.x0, symbol, static_cast<std::size_t>(span.x1 - span.x0 + 1));
+    }
+
+    void fillSpans(const std::vector<Span> &spans, char symbol);
+
+    void fillRect(const Rect &area, char symbol);
+
+    bool contains(int x, int y) const {
+        return x >= 0 && y >= 0 && x < width && y < height;
+    }
+};
+
+#endif
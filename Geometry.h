@@ -0,0 +1,37 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include <algorithm>
+
+struct Span {
+    int y, x0, x1;
+};
+
+// Inclusive cell rectangle; empty when x0 > x1 or y0 > y1.
+struct Rect {
+    int x0, y0, x1, y1;
+
+    bool empty() const {
+        return x0 > x1 || y0 > y1;
+    }
+
+    bool contains(int x, int y) const {
+        return x >= x0 && x <= x1 && y >= y0 && y <= y1;
+    }
+
+    bool intersects(const Rect &other) const {
+        return !empty() && !other.empty() && x0 <= other.x1 && other.x0 <= x1 && y0 <= other.y1 && other.y0 <= y1;
+    }
+
+    Rect intersect(const Rect &other) const {
+        return {std::max(x0, other.x0), std::max(y0, other.y0), std::min(x1, other.x1), std::min(y1, other.y1)};
+    }
+
+    Rect unite(const Rect &other) const {
+        if (empty()) return other;
+        if (other.empty()) return *this;
+        return {std::min(x0, other.x0), std::min(y0, other.y0), std::max(x1, other.x1), std::max(y1, other.y1)};
+    }
+};
+
+#endif
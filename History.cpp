@@ -0,0 +1,132 @@
+#include "History.h"
+#include "Stats.h"
+
+class History::GroupCommand : public Command {
+public:
+    std::vector<std::unique_ptr<Command>> commands;
+
+    void undo() override {
+        for (auto it = commands.rbegin(); it != commands.rend(); ++it) {
+            (*it)->undo();
+        }
+    }
+
+    void redo() override {
+        for (auto &command: commands) {
+            command->redo();
+        }
+    }
+
+    std::size_t footprint() const override {
+        std::size_t total = sizeof(*this) + commands.capacity() * sizeof(commands[0]);
+        for (const auto &command: commands) {
+            total += command->footprint();
+        }
+        return total;
+    }
+};
+
+History::History(std::size_t budgetBytes) : budget(budgetBytes), used(0), groupDepth(0) {}
+
+History::~History() = default;
+
+void History::push(std::unique_ptr<Command> command) {
+    STATS_TIME(HISTORY_PUSH);
+    dropRedo();
+    used += command->footprint();
+    STATS_ADD(HISTORY_BYTES, command->footprint());
+    record(std::move(command));
+}
+
+void History::beginGroup() {
+    ++groupDepth;
+}
+
+void History::endGroup() {
+    if (groupDepth > 0 && --groupDepth == 0) closeGroup();
+}
+
+void History::dropRedo() {
+    for (const auto &undone: redoStack) {
+        used -= undone->footprint();
+    }
+    redoStack.clear();
+}
+
+void History::record(std::unique_ptr<Command> command) {
+    if (groupDepth > 0) {
+        if (!openGroup) openGroup = std::make_unique<GroupCommand>();
+        openGroup->commands.push_back(std::move(command));
+        return;
+    }
+    undoStack.push_back(std::move(command));
+    trim();
+}
+
+void History::closeGroup() {
+    std::unique_ptr<GroupCommand> group = std::move(openGroup);
+    if (!group || group->commands.empty()) return;
+
+    // used already counts the grouped commands; only the group's own bookkeeping is new.
+    if (group->commands.size() == 1) {
+        undoStack.push_back(std::move(group->commands.front()));
+    } else {
+        for (const auto &command: group->commands) {
+            used -= command->footprint();
+        }
+        used += group->footprint();
+        undoStack.push_back(std::move(group));
+    }
+    trim();
+}
+
+bool History::undo() {
+    std::unique_ptr<Command> command;
+    if (openGroup && !openGroup->commands.empty()) {
+        command = std::move(openGroup->commands.back());
+        openGroup->commands.pop_back();
+    } else if (!undoStack.empty()) {
+        command = std::move(undoStack.back());
+        undoStack.pop_back();
+    } else {
+        return false;
+    }
+
+    used -= command->footprint();
+    command->undo();
+    used += command->footprint();
+    redoStack.push_back(std::move(command));
+    return true;
+}
+
+bool History::redo() {
+    if (redoStack.empty()) return false;
+
+    std::unique_ptr<Command> command = std::move(redoStack.back());
+    redoStack.pop_back();
+    used -= command->footprint();
+    command->redo();
+    used += command->footprint();
+    record(std::move(command));
+    return true;
+}
+
+void History::clear() {
+    openGroup.reset();
+    undoStack.clear();
+    redoStack.clear();
+    used = 0;
+}
+
+void History::setBudget(std::size_t budgetBytes) {
+    budget = budgetBytes;
+    trim();
+}
+
+void History::trim() {
+    // The newest entry always survives so the last change can be undone.
+    while (used > budget && undoStack.size() > 1) {
+        used -= undoStack.front()->footprint();
+        undoStack.pop_front();
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <vector>
+
+// A reversible change. Commands keep only what they need to flip between the two states, so an
+// entry costs O(1) for single-shape edits.
+class Command {
+public:
+    virtual ~Command() = default;
+
+    virtual void undo() = 0;
+
+    virtual void redo() = 0;
+
+    // Approximate number of bytes the command keeps alive.
+    virtual std::size_t footprint() const = 0;
+};
+
+// Undo/redo stacks capped by a memory budget; the oldest entries are dropped first.
+class History {
+private:
+    static constexpr std::size_t defaultBudget = 64 * 1024 * 1024;
+
+    class GroupCommand;
+
+    std::deque<std::unique_ptr<Command>> undoStack;
+    std::vector<std::unique_ptr<Command>> redoStack;
+    std::size_t budget, used;
+
+    // Commands pushed since the outermost beginGroup, not yet on the undo stack.
+    std::unique_ptr<GroupCommand> openGroup;
+    int groupDepth;
+
+    void dropRedo();
+
+    // Adds a command to the open group, or to the undo stack when no group is open.
+    void record(std::unique_ptr<Command> command);
+
+    void closeGroup();
+
+    void trim();
+
+public:
+    explicit History(std::size_t budgetBytes = defaultBudget);
+
+    ~History();
+
+    void push(std::unique_ptr<Command> command);
+
+    // Everything pushed until the matching endGroup becomes a single entry. Groups nest. Inside a
+    // group, undo takes back the group's latest command first and redo adds to the group.
+    void beginGroup();
+
+    void endGroup();
+
+    bool undo();
+
+    bool redo();
+
+    void clear();
+
+    void setBudget(std::size_t budgetBytes);
+
+    std::size_t undoCount() const {
+        return undoStack.size();
+    }
+
+    std::size_t redoCount() const {
+        return redoStack.size();
+    }
+
+    std::size_t memoryUsed() const {
+        return used;
+    }
+};
+
+#endif
@@ -0,0 +1,48 @@
+#include <fstream>
+#include <stdexcept>
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string &filePath) : bytes(nullptr), length(0), mapped(false) {
+#ifndef _WIN32
+    int fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Error opening file for reading: " + filePath);
+    }
+
+    struct stat info{};
+    if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+        length = static_cast<std::size_t>(info.st_size);
+        void *address = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            ::madvise(address, length, MADV_SEQUENTIAL);
+            bytes = static_cast<const unsigned char *>(address);
+            mapped = true;
+        }
+    }
+    ::close(fd);
+    if (mapped || length == 0) return;
+#endif
+
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Error opening file for reading: " + filePath);
+    }
+    buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    bytes = buffer.data();
+    length = buffer.size();
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (mapped) {
+        ::munmap(const_cast<unsigned char *>(bytes), length);
+    }
+#endif
+}
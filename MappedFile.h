@@ -0,0 +1,39 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file. POSIX systems map it into memory; elsewhere it is read into a buffer.
+class MappedFile {
+private:
+    const unsigned char *bytes;
+    std::size_t length;
+    bool mapped;
+    std::vector<unsigned char> buffer;
+
+public:
+    explicit MappedFile(const std::string &filePath);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const unsigned char *data() const {
+        return bytes;
+    }
+
+    std::size_t size() const {
+        return length;
+    }
+
+    // False when the file was read into a buffer instead, so its bytes take heap memory.
+    bool isMapped() const {
+        return mapped;
+    }
+};
+
+#endif
@@ -1,13 +1,14 @@
 #include "RaiiWrapper.h"
 
-RaiiWrapper::RaiiWrapper(const std::string &filePath, bool isOutput) {
+RaiiWrapper::RaiiWrapper(const std::string &filePath, bool isOutput, bool binary) {
+    std::ios::openmode mode = binary ? std::ios::binary : std::ios::openmode();
     if (isOutput) {
-        outFile.open(filePath);
+        outFile.open(filePath, std::ios::out | mode);
         if (!outFile) {
             throw std::runtime_error("Error opening file for writing: " + filePath);
         }
     } else {
-        inFile.open(filePath);
+        inFile.open(filePath, std::ios::in | mode);
         if (!inFile) {
             throw std::runtime_error("Error opening file for reading: " + filePath);
         }
@@ -11,7 +11,7 @@ private:
     std::ifstream inFile;
 
 public:
-    RaiiWrapper(const std::string &filePath, bool isOutput);
+    RaiiWrapper(const std::string &filePath, bool isOutput, bool binary = false);
 
     ~RaiiWrapper();
 
@@ -0,0 +1,168 @@
+#include <cstring>
+#include <stdexcept>
+#include "CommandParser.h"
+#include "SceneFile.h"
+#include "ShapeRegistry.h"
+
+namespace {
+    const char binaryMagic[4] = {'S', 'B', 'B', 'D'};
+
+    void putU32(unsigned char *out, std::uint32_t value) {
+        out[0] = static_cast<unsigned char>(value);
+        out[1] = static_cast<unsigned char>(value >> 8);
+        out[2] = static_cast<unsigned char>(value >> 16);
+        out[3] = static_cast<unsigned char>(value >> 24);
+    }
+
+    void putU64(unsigned char *out, std::uint64_t value) {
+        putU32(out, static_cast<std::uint32_t>(value));
+        putU32(out + 4, static_cast<std::uint32_t>(value >> 32));
+    }
+
+    std::uint32_t getU32(const unsigned char *in) {
+        return static_cast<std::uint32_t>(in[0]) | static_cast<std::uint32_t>(in[1]) << 8 |
+               static_cast<std::uint32_t>(in[2]) << 16 | static_cast<std::uint32_t>(in[3]) << 24;
+    }
+
+    std::uint64_t getU64(const unsigned char *in) {
+        return static_cast<std::uint64_t>(getU32(in)) | static_cast<std::uint64_t>(getU32(in + 4)) << 32;
+    }
+
+    void encodeRecord(const ShapeRecord &record, unsigned char *out) {
+        std::uint64_t angleBits;
+        std::memcpy(&angleBits, &record.c, sizeof(angleBits));
+
+        out[0] = record.tag;
+        out[1] = static_cast<unsigned char>(record.colour);
+        out[2] = record.fillMode ? 1 : 0;
+        out[3] = 0;
+        putU32(out + 4, static_cast<std::uint32_t>(record.x));
+        putU32(out + 8, static_cast<std::uint32_t>(record.y));
+        putU32(out + 12, static_cast<std::uint32_t>(record.a));
+        putU32(out + 16, static_cast<std::uint32_t>(record.b));
+        putU32(out + 20, 0);
+        putU64(out + 24, angleBits);
+    }
+}
+
+void SceneFile::writeText(std::ostream &os, int width, int height, const std::vector<std::shared_ptr<Shape>> &shapes) {
+    os << width << ' ' << height << '\n';
+
+    for (const auto &shape: shapes) {
+        shape->serialize(os);
+    }
+}
+
+void SceneFile::writeBinary(std::ostream &os, int width, int height,
+                            const std::vector<std::shared_ptr<Shape>> &shapes) {
+    std::vector<unsigned char> bytes(headerSize + shapes.size() * recordSize);
+    unsigned char *records = bytes.data() + headerSize;
+
+    for (std::size_t i = 0; i < shapes.size(); ++i) {
+        encodeRecord(shapes[i]->toRecord(), records + i * recordSize);
+    }
+
+    std::memcpy(bytes.data(), binaryMagic, sizeof(binaryMagic));
+    putU32(bytes.data() + 4, binaryVersion);
+    putU32(bytes.data() + 8, static_cast<std::uint32_t>(width));
+    putU32(bytes.data() + 12, static_cast<std::uint32_t>(height));
+    putU64(bytes.data() + 16, shapes.size());
+    putU32(bytes.data() + 24, checksum(records, shapes.size() * recordSize));
+    putU32(bytes.data() + 28, 0);
+
+    os.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+ShapeRecord SceneFile::parseLine(std::string_view line) {
+    CommandParser parser(line);
+    std::string_view shapeType = parser.next();
+    const ShapeKind *kind = ShapeRegistry::findName(shapeType);
+    if (!kind) {
+        throw std::runtime_error("Unknown shape type: " + std::string(shapeType));
+    }
+
+    ShapeRecord record{};
+    record.tag = kind->tag;
+    int fillMode = 0;
+    bool valid = parser.next(record.x) && parser.next(record.y) && parser.next(record.colour) &&
+                 parser.next(fillMode) && (fillMode == 0 || fillMode == 1) &&
+                 ShapeRegistry::parseParams(parser, record);
+    record.fillMode = fillMode != 0;
+
+    if (!valid || !parser.atEnd()) {
+        throw std::runtime_error("Malformed " + std::string(shapeType) + " line: " + std::string(line));
+    }
+    return record;
+}
+
+bool SceneFile::isBinary(const unsigned char *data, std::size_t size) {
+    return size >= sizeof(binaryMagic) && std::memcmp(data, binaryMagic, sizeof(binaryMagic)) == 0;
+}
+
+SceneFormat SceneFile::formatFor(const std::string &filePath) {
+    const std::string extension = ".sbb";
+    bool binary = filePath.size() >= extension.size() &&
+                  filePath.compare(filePath.size() - extension.size(), extension.size(), extension) == 0;
+    return binary ? SceneFormat::BINARY : SceneFormat::TEXT;
+}
+
+SceneFile::BinaryHeader SceneFile::readHeader(const unsigned char *header, std::uint64_t fileSize) {
+    if (fileSize < headerSize || !isBinary(header, headerSize)) {
+        throw std::runtime_error("Not a binary scene file.");
+    }
+    if (getU32(header + 4) != binaryVersion) {
+        throw std::runtime_error("Unsupported binary scene version.");
+    }
+
+    BinaryHeader result{static_cast<std::int32_t>(getU32(header + 8)), static_cast<std::int32_t>(getU32(header + 12)),
+                        getU64(header + 16), getU32(header + 24)};
+    if (result.width <= 0 || result.height <= 0) {
+        throw std::runtime_error("Invalid board dimensions.");
+    }
+    if (result.count > (fileSize - headerSize) / recordSize || headerSize + result.count * recordSize != fileSize) {
+        throw std::runtime_error("Binary scene file is truncated or has trailing data.");
+    }
+    return result;
+}
+
+ShapeRecord SceneFile::decodeRecord(const unsigned char *in) {
+    ShapeRecord record{};
+    std::uint64_t angleBits = getU64(in + 24);
+    std::memcpy(&record.c, &angleBits, sizeof(angleBits));
+
+    record.tag = in[0];
+    record.colour = static_cast<char>(in[1]);
+    record.fillMode = in[2] != 0;
+    record.x = static_cast<std::int32_t>(getU32(in + 4));
+    record.y = static_cast<std::int32_t>(getU32(in + 8));
+    record.a = static_cast<std::int32_t>(getU32(in + 12));
+    record.b = static_cast<std::int32_t>(getU32(in + 16));
+    return record;
+}
+
+std::uint32_t SceneFile::checksum(const unsigned char *data, std::size_t size, std::uint32_t hash) {
+    for (std::size_t i = 0; i < size; ++i) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+std::shared_ptr<Shape> SceneFile::makeShape(const ShapeRecord &record, int boardWidth, int boardHeight) {
+    if (record.x < 0 || record.y < 0 || record.x >= boardWidth || record.y >= boardHeight) {
+        throw std::runtime_error("Invalid position for shape.");
+    }
+
+    if (!ShapeRegistry::contains(record.tag)) {
+        throw std::runtime_error("Unknown shape tag: " + std::to_string(record.tag));
+    }
+    const ShapeKind &kind = ShapeRegistry::kindOf(record.tag);
+    if (const ShapeParam *invalid = ShapeRegistry::invalidParam(record)) {
+        throw std::runtime_error("Invalid " + std::string(invalid->name) + " for " + std::string(kind.name) + ".");
+    }
+
+    std::shared_ptr<Shape> shape = ShapeRegistry::make(record);
+    if (!shape->isWithinBounds(boardWidth, boardHeight)) {
+        throw std::runtime_error(std::string(kind.name) + " out of bounds.");
+    }
+    return shape;
+}
@@ -0,0 +1,63 @@
+#ifndef SCENEFILE_H
+#define SCENEFILE_H
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Shape.h"
+
+enum class SceneFormat {
+    TEXT,
+    BINARY
+};
+
+// Writers for the scene files, and the pieces SceneLoader parses them with. The text format is the
+// hand-editable "width height" line followed by one shape per line. The binary format (version 1,
+// all fields little-endian) is
+//
+//   header, 32 bytes: "SBBD", u32 version, i32 width, i32 height, u64 record count,
+//                     u32 FNV-1a checksum of the records, u32 reserved
+//   record, 32 bytes: u8 tag, u8 colour, u8 fill, u8 reserved, i32 x, i32 y, i32 a, i32 b,
+//                     u32 reserved, f64 c
+//
+// with the fields of ShapeRecord. The parsing helpers throw std::runtime_error on malformed input.
+class SceneFile {
+public:
+    static constexpr std::uint32_t binaryVersion = 1;
+    static constexpr std::size_t headerSize = 32;
+    static constexpr std::size_t recordSize = 32;
+
+    struct BinaryHeader {
+        int width, height;
+        std::uint64_t count;
+        std::uint32_t checksum;
+    };
+
+    static void writeText(std::ostream &os, int width, int height, const std::vector<std::shared_ptr<Shape>> &shapes);
+
+    static void writeBinary(std::ostream &os, int width, int height, const std::vector<std::shared_ptr<Shape>> &shapes);
+
+    static bool isBinary(const unsigned char *data, std::size_t size);
+
+    // Binary for paths ending in ".sbb", text otherwise.
+    static SceneFormat formatFor(const std::string &filePath);
+
+    // Checks the header of a binary file of fileSize bytes, including that the records fill the rest.
+    static BinaryHeader readHeader(const unsigned char *header, std::uint64_t fileSize);
+
+    static ShapeRecord decodeRecord(const unsigned char *in);
+
+    // FNV-1a over the record bytes; pass the previous result as hash to continue over the next bytes.
+    static std::uint32_t checksum(const unsigned char *data, std::size_t size, std::uint32_t hash = 2166136261u);
+
+    // Parses one shape line of the text format.
+    static ShapeRecord parseLine(std::string_view line);
+
+    // Validates a record against the board and builds the shape it describes.
+    static std::shared_ptr<Shape> makeShape(const ShapeRecord &record, int boardWidth, int boardHeight);
+};
+
+#endif
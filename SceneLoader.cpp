@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+#include "CommandParser.h"
+#include "MappedFile.h"
+#include "SceneFile.h"
+#include "SceneLoader.h"
+#include "Stats.h"
+
+namespace {
+    // A few pieces per thread so stealing can even out pieces that parse slower than others, but
+    // none so small that handing it out costs more than parsing it.
+    constexpr std::size_t piecesPerThread = 4;
+    constexpr std::size_t minPieceBytes = 64 * 1024;
+
+    std::size_t pieceCount(const ThreadPool *pool, std::size_t bytes) {
+        std::size_t most = pool ? pool->threadCount() * piecesPerThread : 1;
+        return std::max<std::size_t>(1, std::min(most, bytes / minPieceBytes));
+    }
+
+    // Runs body for every piece and rethrows the error of the first piece that failed, so the
+    // message is the one a serial pass would have stopped at.
+    void forEachPiece(ThreadPool *pool, std::size_t count, const std::function<void(std::size_t)> &body) {
+        std::vector<std::exception_ptr> errors(count);
+        std::function<void(std::size_t)> guarded = [&](std::size_t piece) {
+            try {
+                body(piece);
+            } catch (...) {
+                errors[piece] = std::current_exception();
+            }
+        };
+
+        if (pool) {
+            pool->parallelFor(count, guarded);
+        } else {
+            for (std::size_t piece = 0; piece < count; ++piece) guarded(piece);
+        }
+        for (const auto &error: errors) {
+            if (error) std::rethrow_exception(error);
+        }
+    }
+
+    void checkMemory(const SceneLoader::Options &options, std::size_t shapes, std::size_t bufferBytes) {
+        if (options.memoryLimit && shapes * SceneLoader::shapeFootprint + bufferBytes > options.memoryLimit) {
+            throw std::runtime_error("Scene needs more than the load limit of " +
+                                     std::to_string(options.memoryLimit) + " bytes.");
+        }
+    }
+
+    class ChunkReader {
+    private:
+        std::ifstream file;
+        std::uint64_t total = 0, done = 0;
+        const SceneLoader::Options &options;
+
+    public:
+        ChunkReader(const std::string &filePath, const SceneLoader::Options &options)
+                : file(filePath, std::ios::binary), options(options) {
+            if (!file) {
+                throw std::runtime_error("Error opening file for reading: " + filePath);
+            }
+            file.seekg(0, std::ios::end);
+            total = static_cast<std::uint64_t>(std::max<std::streamoff>(0, file.tellg()));
+            file.seekg(0, std::ios::beg);
+        }
+
+        std::uint64_t size() const {
+            return total;
+        }
+
+        // The first bytes of the file, without moving past them.
+        bool isBinary() {
+            unsigned char magic[4] = {};
+            file.read(reinterpret_cast<char *>(magic), sizeof(magic));
+            auto got = static_cast<std::size_t>(file.gcount());
+            file.clear();
+            file.seekg(0, std::ios::beg);
+            return SceneFile::isBinary(magic, got);
+        }
+
+        // Reads up to count bytes into out and returns how many arrived.
+        std::size_t read(unsigned char *out, std::size_t count) {
+            file.read(reinterpret_cast<char *>(out), static_cast<std::streamsize>(count));
+            auto got = static_cast<std::size_t>(file.gcount());
+            done += got;
+            STATS_ADD(FILE_BYTES_READ, got);
+            if (options.progress) options.progress(done, total);
+            return got;
+        }
+    };
+
+    // Binary records are fixed-size, so chunks are cut straight out of the mapped file and nothing is
+    // copied before decoding. Mapped pages are backed by the file, so only the shapes count against the
+    // memory limit; where the file had to be read into a buffer, that buffer counts as well.
+    void loadBinary(const MappedFile &file, const SceneLoader::Options &options, int &width, int &height,
+                    std::vector<std::shared_ptr<Shape>> &shapes) {
+        SceneFile::BinaryHeader header = SceneFile::readHeader(file.data(), file.size());
+        width = header.width;
+        height = header.height;
+        checkMemory(options, header.count, file.isMapped() ? 0 : file.size());
+        shapes.reserve(header.count);
+
+        std::size_t perChunk = std::max<std::size_t>(1, options.chunkBytes / SceneFile::recordSize);
+        const unsigned char *chunk = file.data() + SceneFile::headerSize;
+        std::uint32_t hash = SceneFile::checksum(nullptr, 0);
+        for (std::uint64_t done = 0; done < header.count;) {
+            auto records = static_cast<std::size_t>(std::min<std::uint64_t>(perChunk, header.count - done));
+            std::size_t bytes = records * SceneFile::recordSize;
+            hash = SceneFile::checksum(chunk, bytes, hash);
+
+            std::size_t base = shapes.size();
+            shapes.resize(base + records);
+            std::size_t pieces = pieceCount(options.pool, bytes);
+            forEachPiece(options.pool, pieces, [&](std::size_t piece) {
+                for (std::size_t i = records * piece / pieces; i < records * (piece + 1) / pieces; ++i) {
+                    ShapeRecord record = SceneFile::decodeRecord(chunk + i * SceneFile::recordSize);
+                    shapes[base + i] = SceneFile::makeShape(record, width, height);
+                }
+            });
+
+            chunk += bytes;
+            done += records;
+            STATS_ADD(FILE_BYTES_READ, bytes);
+            if (options.progress) {
+                options.progress(SceneFile::headerSize + done * SceneFile::recordSize, file.size());
+            }
+        }
+
+        if (hash != header.checksum) {
+            throw std::runtime_error("Binary scene checksum mismatch.");
+        }
+    }
+
+    // Parses the shape lines of text, which ends at a line break or at the end of the file.
+    void parseLines(std::string_view text, const SceneLoader::Options &options, int width, int height,
+                    std::vector<std::shared_ptr<Shape>> &shapes) {
+        std::size_t pieces = pieceCount(options.pool, text.size());
+        std::vector<std::size_t> starts(pieces + 1, text.size());
+        starts[0] = 0;
+        for (std::size_t piece = 1; piece < pieces; ++piece) {
+            std::size_t lineEnd = text.find('\n', std::max(starts[piece - 1], text.size() * piece / pieces));
+            starts[piece] = lineEnd == std::string_view::npos ? text.size() : lineEnd + 1;
+        }
+
+        std::vector<std::vector<std::shared_ptr<Shape>>> parsed(pieces);
+        forEachPiece(options.pool, pieces, [&](std::size_t piece) {
+            std::string_view rest = text.substr(starts[piece], starts[piece + 1] - starts[piece]);
+            while (!rest.empty()) {
+                std::size_t lineEnd = std::min(rest.find('\n'), rest.size());
+                std::string_view line = rest.substr(0, lineEnd);
+                rest.remove_prefix(std::min(lineEnd + 1, rest.size()));
+                if (CommandParser(line).atEnd()) continue;
+                parsed[piece].push_back(SceneFile::makeShape(SceneFile::parseLine(line), width, height));
+            }
+        });
+
+        for (auto &piece: parsed) {
+            shapes.insert(shapes.end(), std::make_move_iterator(piece.begin()), std::make_move_iterator(piece.end()));
+        }
+    }
+
+    void loadText(ChunkReader &reader, const SceneLoader::Options &options, int &width, int &height,
+                  std::vector<std::shared_ptr<Shape>> &shapes) {
+        std::size_t chunkBytes = std::max<std::size_t>(1, options.chunkBytes);
+        std::vector<unsigned char> buffer;
+        bool headerRead = false, atEnd = false;
+
+        while (!atEnd) {
+            // Whatever follows the last line break of the previous chunk is carried over to this one.
+            std::size_t carried = buffer.size();
+            buffer.resize(carried + chunkBytes);
+            std::size_t got = reader.read(buffer.data() + carried, chunkBytes);
+            buffer.resize(carried + got);
+            atEnd = got < chunkBytes;
+            checkMemory(options, shapes.size(), buffer.capacity());
+
+            std::string_view text(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+            if (!atEnd) {
+                std::size_t lastBreak = text.rfind('\n');
+                if (lastBreak == std::string_view::npos) continue;
+                text = text.substr(0, lastBreak + 1);
+            }
+            std::size_t consumed = text.size();
+
+            if (!headerRead) {
+                std::size_t lineEnd = std::min(text.find('\n'), text.size());
+                CommandParser parser(text.substr(0, lineEnd));
+                if (!parser.next(width) || !parser.next(height) || width <= 0 || height <= 0 || !parser.atEnd()) {
+                    throw std::runtime_error("Invalid board dimensions.");
+                }
+                text.remove_prefix(std::min(lineEnd + 1, text.size()));
+                headerRead = true;
+            }
+
+            parseLines(text, options, width, height, shapes);
+            buffer.erase(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(consumed));
+        }
+        checkMemory(options, shapes.size(), 0);
+    }
+}
+
+void SceneLoader::load(const std::string &filePath, const Options &options, int &width, int &height,
+                       std::vector<std::shared_ptr<Shape>> &shapes) {
+    int loadedWidth = 0, loadedHeight = 0;
+    std::vector<std::shared_ptr<Shape>> loaded;
+
+    bool binary;
+    {
+        ChunkReader reader(filePath, options);
+        binary = reader.isBinary();
+        if (!binary) loadText(reader, options, loadedWidth, loadedHeight, loaded);
+    }
+    if (binary) {
+        MappedFile file(filePath);
+        loadBinary(file, options, loadedWidth, loadedHeight, loaded);
+    }
+
+    width = loadedWidth;
+    height = loadedHeight;
+    shapes = std::move(loaded);
+}
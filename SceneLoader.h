@@ -0,0 +1,41 @@
+#ifndef SCENELOADER_H
+#define SCENELOADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Shape.h"
+#include "ThreadPool.h"
+
+// Loads scene files of either format without copying the whole file onto the heap. Text files are
+// read in chunks cut at the last line break; binary files are mapped with MappedFile and walked in
+// chunks of whole records straight from the mapping. Each chunk is split into pieces that parse
+// and validate on the pool, and the shapes are appended in file order. The text reader expects one
+// shape per line, as SceneFile::writeText writes them.
+// Errors throw std::runtime_error and leave the shapes passed in untouched.
+class SceneLoader {
+public:
+    // Rough cost of one loaded shape: the pooled object with its control block and the pointer to it.
+    static constexpr std::size_t shapeFootprint = 96;
+
+    struct Options {
+        std::size_t chunkBytes = 4 << 20;
+
+        // Bytes the chunk buffer and the loaded shapes may take together; 0 for no limit.
+        std::size_t memoryLimit = 0;
+
+        // Parses on the calling thread when null.
+        ThreadPool *pool = nullptr;
+
+        // Called after every chunk with the bytes read so far and the file size.
+        std::function<void(std::uint64_t, std::uint64_t)> progress;
+    };
+
+    static void load(const std::string &filePath, const Options &options, int &width, int &height,
+                     std::vector<std::shared_ptr<Shape>> &shapes);
+};
+
+#endif
@@ -0,0 +1,172 @@
+#include "SceneStore.h"
+#include "Stats.h"
+
+namespace {
+    void countDrawn(const std::vector<Span> &spans) {
+#if BLACKBOARD_STATS
+        std::uint64_t cells = 0;
+        for (const auto &span: spans) {
+            cells += static_cast<std::uint64_t>(span.x1 - span.x0 + 1);
+        }
+        Stats::add(Stats::SHAPES_RASTERIZED, 1);
+        Stats::add(Stats::CELLS_WRITTEN, cells);
+#else
+        (void) spans;
+#endif
+    }
+}
+
+std::uint32_t SceneStore::Pool::add(const ShapeRecord &record) {
+    if (!freeSlots.empty()) {
+        std::uint32_t slot = freeSlots.back();
+        freeSlots.pop_back();
+        set(slot, record);
+        return slot;
+    }
+    x.push_back(record.x);
+    y.push_back(record.y);
+    a.push_back(record.a);
+    b.push_back(record.b);
+    c.push_back(record.c);
+    colour.push_back(record.colour);
+    fillMode.push_back(record.fillMode);
+    box.push_back(ShapeRegistry::boundsOf(record));
+    return static_cast<std::uint32_t>(x.size() - 1);
+}
+
+void SceneStore::Pool::set(std::size_t slot, const ShapeRecord &record) {
+    x[slot] = record.x;
+    y[slot] = record.y;
+    a[slot] = record.a;
+    b[slot] = record.b;
+    c[slot] = record.c;
+    colour[slot] = record.colour;
+    fillMode[slot] = record.fillMode;
+    box[slot] = ShapeRegistry::boundsOf(record);
+}
+
+void SceneStore::Pool::clear() {
+    x.clear();
+    y.clear();
+    a.clear();
+    b.clear();
+    c.clear();
+    colour.clear();
+    fillMode.clear();
+    box.clear();
+    freeSlots.clear();
+}
+
+void SceneStore::clear() {
+    for (auto &pool: pools) {
+        pool.clear();
+    }
+    order.clear();
+}
+
+void SceneStore::insert(std::size_t id, const ShapeRecord &record) {
+    order.insert(order.begin() + id, {record.tag, pools[record.tag].add(record)});
+}
+
+void SceneStore::erase(std::size_t id) {
+    pools[order[id].kind].freeSlots.push_back(order[id].slot);
+    order.erase(order.begin() + id);
+}
+
+void SceneStore::replace(std::size_t id, const ShapeRecord &record) {
+    Entry &entry = order[id];
+    if (entry.kind == record.tag) {
+        pools[record.tag].set(entry.slot, record);
+    } else {
+        pools[entry.kind].freeSlots.push_back(entry.slot);
+        entry = {record.tag, pools[record.tag].add(record)};
+    }
+}
+
+void SceneStore::rebuild(const std::vector<std::shared_ptr<Shape>> &shapes) {
+    clear();
+    order.reserve(shapes.size());
+    for (const auto &shape: shapes) {
+        insert(order.size(), shape->toRecord());
+    }
+}
+
+void SceneStore::rasterize(std::size_t id, const Rect &clip, std::vector<Span> &spans) const {
+    Entry entry = order[id];
+    ShapeRegistry::rasterize(pools[entry.kind].record(entry.kind, entry.slot), clip, spans);
+}
+
+char SceneStore::colourOf(std::size_t id) const {
+    return pools[order[id].kind].colour[order[id].slot];
+}
+
+bool SceneStore::covers(std::size_t id, int x, int y) const {
+    Entry entry = order[id];
+    return ShapeRegistry::covers(pools[entry.kind].record(entry.kind, entry.slot), x, y);
+}
+
+bool SceneStore::sameSpot(std::size_t id, const ShapeRecord &record) const {
+    Entry entry = order[id];
+    return entry.kind == record.tag &&
+           ShapeRegistry::sameSpot(pools[entry.kind].record(entry.kind, entry.slot), record);
+}
+
+void SceneStore::drawAll(Framebuffer &board, const Rect &clip, std::size_t first, std::size_t last) const {
+    for (std::size_t id = first; id < last; ++id) {
+        if (bounds(id).intersects(clip)) draw(id, board, clip);
+    }
+}
+
+void SceneStore::draw(std::size_t id, Framebuffer &target, const Rect &clip, int originX, int originY,
+                      int zoom) const {
+    thread_local std::vector<Span> spans;
+    spans.clear();
+    if (zoom == 1) {
+        rasterize(id, clip, spans);
+        if (originX || originY) {
+            for (auto &span: spans) {
+                span = {span.y - originY, span.x0 - originX, span.x1 - originX};
+            }
+        }
+        target.fillSpans(spans, colourOf(id));
+        countDrawn(spans);
+        return;
+    }
+
+    // Only the board row through the centres of each row of blocks is rasterized, and a span fills
+    // the target cells whose block centre it covers, so the work follows the target's size.
+    Rect area = clip.intersect(bounds(id));
+    if (area.empty()) return;
+    int centre = zoom / 2;
+    auto firstBlock = [&](int cell, int origin) { return (cell - origin - centre + zoom - 1) / zoom; };
+    auto lastBlock = [&](int cell, int origin) { return (cell - origin - centre + zoom) / zoom - 1; };
+
+    for (int row = firstBlock(area.y0, originY); row <= lastBlock(area.y1, originY); ++row) {
+        int boardY = originY + row * zoom + centre;
+        std::size_t rowStart = spans.size();
+        rasterize(id, {area.x0, boardY, area.x1, boardY}, spans);
+
+        std::size_t kept = rowStart;
+        for (std::size_t i = rowStart; i < spans.size(); ++i) {
+            int x0 = firstBlock(spans[i].x0, originX), x1 = lastBlock(spans[i].x1, originX);
+            if (x0 <= x1) spans[kept++] = {row, x0, x1};
+        }
+        spans.resize(kept);
+    }
+    target.fillSpans(spans, colourOf(id));
+    countDrawn(spans);
+}
+
+void SceneStore::drawAll(TiledFramebuffer &board, const Rect &clip, std::size_t first, std::size_t last) const {
+    for (std::size_t id = first; id < last; ++id) {
+        if (bounds(id).intersects(clip)) draw(id, board, clip);
+    }
+}
+
+void SceneStore::draw(std::size_t id, TiledFramebuffer &target, const Rect &clip) const {
+    thread_local std::vector<Span> spans;
+    spans.clear();
+    rasterize(id, clip, spans);
+    target.fillSpans(spans, colourOf(id));
+    countDrawn(spans);
+}
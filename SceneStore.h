@@ -0,0 +1,95 @@
+#ifndef SCENESTORE_H
+#define SCENESTORE_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Framebuffer.h"
+#include "Geometry.h"
+#include "Shape.h"
+#include "ShapeRegistry.h"
+#include "TiledFramebuffer.h"
+
+// Data-oriented copy of the scene that the render and query paths run on. Each shape kind lives in
+// its own struct-of-arrays pool, and order maps z positions (ids in the shape list) to pool slots,
+// so the hot loops dispatch on a one-byte tag through ShapeRegistry instead of chasing pointers
+// through virtual calls. Slots never record their id: a z position lives only in order, so inserting
+// or erasing below the top moves order entries and touches no pool.
+class SceneStore {
+private:
+    // Columns follow ShapeRecord: a and b are the integer sizes, c is only used by lines. box caches
+    // each shape's bounds so culling never recomputes them. Erased slots go on freeSlots and are
+    // reused by the next insert of that kind.
+    struct Pool {
+        std::vector<int> x, y, a, b;
+        std::vector<double> c;
+        std::vector<char> colour;
+        std::vector<unsigned char> fillMode;
+        std::vector<Rect> box;
+        std::vector<std::uint32_t> freeSlots;
+
+        ShapeRecord record(std::uint8_t tag, std::size_t slot) const {
+            return {tag, colour[slot], fillMode[slot] != 0, x[slot], y[slot], a[slot], b[slot], c[slot]};
+        }
+
+        // Returns the slot the record went into.
+        std::uint32_t add(const ShapeRecord &record);
+
+        void set(std::size_t slot, const ShapeRecord &record);
+
+        void clear();
+    };
+
+    struct Entry {
+        std::uint8_t kind;
+        std::uint32_t slot;
+    };
+
+    // Indexed by tag; tags start at 1.
+    std::array<Pool, ShapeRegistry::count + 1> pools;
+    std::vector<Entry> order;
+
+public:
+    std::size_t size() const {
+        return order.size();
+    }
+
+    void clear();
+
+    void insert(std::size_t id, const ShapeRecord &record);
+
+    void erase(std::size_t id);
+
+    void replace(std::size_t id, const ShapeRecord &record);
+
+    void rebuild(const std::vector<std::shared_ptr<Shape>> &shapes);
+
+    const Rect &bounds(std::size_t id) const {
+        return pools[order[id].kind].box[order[id].slot];
+    }
+
+    void rasterize(std::size_t id, const Rect &clip, std::vector<Span> &spans) const;
+
+    char colourOf(std::size_t id) const;
+
+    bool covers(std::size_t id, int x, int y) const;
+
+    // Same duplicate rule as Shape::isSameSpot.
+    bool sameSpot(std::size_t id, const ShapeRecord &record) const;
+
+    // Draws the shapes with ids first .. last - 1 that touch clip, in z-order.
+    void drawAll(Framebuffer &board, const Rect &clip, std::size_t first, std::size_t last) const;
+
+    // Cell (x, y) of the board lands on cell ((x - originX) / zoom, (y - originY) / zoom) of target.
+    // With a zoom above one each target cell samples the centre of its block, so drawing the shapes
+    // in z-order leaves it the colour of the topmost shape covering that cell.
+    void draw(std::size_t id, Framebuffer &target, const Rect &clip, int originX = 0, int originY = 0,
+              int zoom = 1) const;
+
+    void drawAll(TiledFramebuffer &board, const Rect &clip, std::size_t first, std::size_t last) const;
+
+    void draw(std::size_t id, TiledFramebuffer &target, const Rect &clip) const;
+};
+
+#endif
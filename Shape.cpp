@@ -1,315 +1,375 @@
+#include <algorithm>
+#include <limits>
+#include <sstream>
 #include "Shape.h"
+#include "ShapeRegistry.h"
+#include "Simd.h"
+
+namespace {
+    // Bounds are computed for whatever size was typed, before isWithinBounds can reject it, so they
+    // saturate at the int range instead of overflowing.
+    int saturate(long long value) {
+        return static_cast<int>(std::max<long long>(std::numeric_limits<int>::min(),
+                                                    std::min<long long>(value, std::numeric_limits<int>::max())));
+    }
 
-Shape::Shape(int x, int y, char colour, bool fillMode) : x(x), y(y), colour(colour), fillMode(fillMode) {}
+    // Appends the part of [x0, x1] on row y that lies inside the clip columns; rows are clipped by the callers.
+    void addSpan(std::vector<Span> &spans, int y, int x0, int x1, const Rect &clip) {
+        if (x0 < clip.x0) x0 = clip.x0;
+        if (x1 > clip.x1) x1 = clip.x1;
+        if (x0 <= x1) spans.push_back({y, x0, x1});
+    }
 
-std::pair<int, int> Shape::getPosition() const {
-    return {x, y};
-}
+    // Line cells in fixed point: step i along the major axis moves round(i * minor / major) along
+    // the minor one, halves rounding up. Both are absolute deltas with minor <= major.
+    long long minorOffset(long long major, long long minor, long long i) {
+        return major == 0 ? 0 : (major + 2 * i * minor) / (2 * major);
+    }
+
+    long long floorDiv(long long a, long long b) {
+        return a / b - (a % b != 0 && (a < 0) != (b < 0));
+    }
 
-SRectangle::SRectangle(int x, int y, char colour, bool fillMode, int w, int h) : Shape(x, y, colour, fillMode),
-                                                                                 width(w),
-                                                                                 height(h) {}
+    // Narrows [first, last] to the major steps whose minor offset lies in [lo, hi], so a clip a few
+    // rows tall walks only the cells on those rows. False when there are none.
+    bool minorRange(long long major, long long minor, long long lo, long long hi, int &first, int &last) {
+        if (minor == 0) return lo <= 0 && hi >= 0 && first <= last;
+        // minorOffset(i) >= lo  <=>  i >= ceil((2 * major * lo - major) / (2 * minor)), and
+        // minorOffset(i) <= hi  <=>  i <= floor((2 * major * (hi + 1) - major - 1) / (2 * minor)).
+        long long from = -floorDiv(major - 2 * major * lo, 2 * minor);
+        long long to = floorDiv(2 * major * (hi + 1) - major - 1, 2 * minor);
+        first = static_cast<int>(std::max<long long>(first, from));
+        last = static_cast<int>(std::min<long long>(last, to));
+        return first <= last;
+    }
 
-void SRectangle::editSize(std::vector<float> sizes) {
-    if (sizes.size() == 2) {
-        this->width = int(sizes[0]);
-        this->height = int(sizes[1]);
-    } else {
-        std::cout << "Rectangle requires 2 size parameters (width and height)." << std::endl;
+    // Steps i in [0, steps] whose coordinate origin + sign * i lies in [lo, hi]. False when there are none.
+    bool stepRange(int origin, int sign, int steps, int lo, int hi, int &first, int &last) {
+        first = std::max(0, sign > 0 ? lo - origin : origin - hi);
+        last = std::min(steps, sign > 0 ? hi - origin : origin - lo);
+        return first <= last;
     }
 }
 
-void SRectangle::draw(std::vector<std::vector<char>> &board) const {
-    int boardHeight = board.size();
-    int boardWidth = board[0].size();
+Shape::Shape(std::uint8_t tag, int x, int y, char colour, bool fillMode)
+        : tag(tag), x(x), y(y), colour(colour), fillMode(fillMode), bounds{x, y, x, y} {}
 
-    char symbol = getColour();
+std::pair<int, int> Shape::getPosition() const {
+    return {x, y};
+}
 
-    if (getFillMode()) {
-        for (int j = y; j < y + height && j < boardHeight; ++j) {
-            for (int i = x; i < x + width && i < boardWidth; ++i) {
-                if (i >= 0 && j >= 0) {
-                    board[j][i] = symbol;
-                }
-            }
-        }
-    } else {
-        for (int i = x; i < x + width && i < boardWidth; ++i) {
-            if (y >= 0 && y < boardHeight) board[y][i] = symbol;
-            if (y + height - 1 >= 0 && y + height - 1 < boardHeight) board[y + height - 1][i] = symbol;
-        }
-        for (int j = y; j < y + height && j < boardHeight; ++j) {
-            if (x >= 0 && x < boardWidth) board[j][x] = symbol;
-            if (x + width - 1 >= 0 && x + width - 1 < boardWidth) board[j][x + width - 1] = symbol;
+void Shape::draw(Framebuffer &board) const {
+    draw(board, {0, 0, board.getWidth() - 1, board.getHeight() - 1});
+}
+
+bool Shape::isWithinBounds(int boardWidth, int boardHeight) const {
+    return x >= 0 && y >= 0 && x < boardWidth && y < boardHeight &&
+           ShapeRegistry::fitsBoard(toRecord(), boardWidth, boardHeight);
+}
+
+bool Shape::editSize(const float *sizes, std::size_t count) {
+    const ShapeKind &kind = ShapeRegistry::kindOf(tag);
+    if (count != kind.paramCount) {
+        std::cout << kind.name << " requires " << kind.paramCount << " size parameter"
+                  << (kind.paramCount == 1 ? "" : "s") << " (";
+        for (std::size_t i = 0; i < kind.paramCount; ++i) {
+            std::cout << (i == 0 ? "" : i + 1 == kind.paramCount ? " and " : ", ") << kind.params[i].name;
         }
+        std::cout << ").\n";
+        return false;
+    }
+
+    ShapeRecord record = toRecord();
+    for (std::size_t i = 0; i < count; ++i) {
+        ShapeRegistry::setParam(record, kind.params[i], sizes[i]);
     }
+    if (const ShapeParam *invalid = ShapeRegistry::invalidParam(record)) {
+        std::cout << "Invalid " << invalid->name << " for " << kind.name << ".\n";
+        return false;
+    }
+    // The tag names this object's type, so the cast cannot go wrong.
+    ShapeRegistry::visit(tag, [&](auto type) {
+        using Type = typename decltype(type)::type;
+        static_cast<Type &>(*this) = Type(record);
+    });
+    return true;
 }
 
-bool SRectangle::isSameSpot(const Shape &other) const {
-    const auto *otherRect = dynamic_cast<const SRectangle *>(&other);
-    return otherRect && otherRect->x == x && otherRect->y == y && otherRect->width == width &&
-           otherRect->height == height;
+void Shape::rasterize(const Rect &clip, std::vector<Span> &spans) const {
+    ShapeRegistry::rasterize(toRecord(), clip, spans);
 }
 
-std::string SRectangle::getType() const {
-    return "Rectangle";
+bool Shape::isSameSpot(const Shape &other) const {
+    return ShapeRegistry::sameSpot(toRecord(), other.toRecord());
 }
 
-int SRectangle::getWidth() const {
-    return width;
+std::string_view Shape::getType() const {
+    return ShapeRegistry::kindOf(tag).name;
 }
 
-int SRectangle::getHeight() const {
-    return height;
+bool Shape::coversPoint(const Framebuffer &board, int x, int y) const {
+    return board.contains(x, y) && ShapeRegistry::covers(toRecord(), x, y);
 }
 
-bool SRectangle::isWithinBounds(int boardWidth, int boardHeight) const {
-    return x >= 0 && y >= 0 && x < boardWidth && y < boardHeight && width <= boardWidth && height <= boardHeight;
+std::string Shape::describe() const {
+    std::ostringstream oss;
+    ShapeRegistry::describe(oss, toRecord());
+    return oss.str();
 }
 
-bool SRectangle::coversPoint(std::vector<std::vector<char>> &board, int x, int y) const {
-    int boardHeight = board.size();
-    int boardWidth = board[0].size();
+std::shared_ptr<Shape> Shape::clone() const {
+    return ShapeRegistry::visit(tag, [&](auto type) -> std::shared_ptr<Shape> {
+        using Type = typename decltype(type)::type;
+        return makePooled<Type>(static_cast<const Type &>(*this));
+    });
+}
 
-    if (getFillMode()) {
-        for (int j = this->y; j < this->y + height && j < boardHeight; ++j) {
-            for (int i = this->x; i < this->x + width && i < boardWidth; ++i) {
-                if (i == x && j == y) {
-                    return true;
-                }
-            }
-        }
-    } else {
-        for (int i = this->x; i < this->x + width && i < boardWidth; ++i) {
-            if ((this->y >= 0 && this->y < boardHeight) && this->y == y && i == x) return true;
-            if ((this->y + height - 1 >= 0 && this->y + height - 1 < boardHeight) && this->y + height - 1 == y &&
-                i == x)
-                return true;
-        }
-        for (int j = this->y; j < this->y + height && j < boardHeight; ++j) {
-            if ((this->x >= 0 && this->x < boardWidth) && j == y && this->x == x) return true;
-            if ((this->x + width - 1 >= 0 && this->x + width - 1 < boardWidth) && j == y &&
-                this->x + width - 1 == x)
-                return true;
-        }
-    }
-    return false;
+void Shape::serialize(std::ostream &os) const {
+    ShapeRegistry::writeText(os, toRecord());
+    os << '\n';
 }
 
-Circle::Circle(int x, int y, char colour, bool fillMode, int r) : Shape(x, y, colour, fillMode), radius(r) {}
+void Shape::draw(Framebuffer &board, const Rect &clip) const {
+    if (!bounds.intersects(clip)) return;
 
-void Circle::editSize(std::vector<float> sizes) {
-    if (sizes.size() == 1) {
-        this->radius = int(sizes[0]);
-    } else {
-        std::cout << "Circle requires 1 size parameter (radius)." << std::endl;
-    }
+    thread_local std::vector<Span> spans;
+    spans.clear();
+    rasterize(clip, spans);
+    board.fillSpans(spans, colour);
 }
 
-void Circle::draw(std::vector<std::vector<char>> &board) const {
-    int boardHeight = board.size();
-    int boardWidth = board[0].size();
+SRectangle::SRectangle(int x, int y, char colour, bool fillMode, int w, int h)
+        : Shape(kind.tag, x, y, colour, fillMode), width(w), height(h) {
+    bounds = boundsOf(x, y, width, height);
+}
 
-    char symbol = getColour();
+void SRectangle::rasterizeSpans(int x, int y, int width, int height, bool fillMode, const Rect &clip,
+                                std::vector<Span> &spans) {
+    if (width <= 0 || height <= 0) return;
 
-    for (int i = -radius; i <= radius; ++i) {
-        for (int j = -radius; j <= radius; ++j) {
-            int dist = i * i + j * j;
-            if ((getFillMode() && dist <= radius * radius) ||
-                (!getFillMode() && dist >= radius * radius - radius && dist <= radius * radius + radius)) {
-                int drawX = x + j;
-                int drawY = y + i;
-                if (drawX >= 0 && drawX < boardWidth && drawY >= 0 && drawY < boardHeight) {
-                    board[drawY][drawX] = symbol;
-                }
-            }
+    int top = std::max(y, clip.y0);
+    int bottom = std::min(y + height - 1, clip.y1);
+    int right = x + width - 1;
+
+    for (int j = top; j <= bottom; ++j) {
+        if (fillMode || j == y || j == y + height - 1) {
+            addSpan(spans, j, x, right, clip);
+        } else {
+            addSpan(spans, j, x, x, clip);
+            addSpan(spans, j, right, right, clip);
         }
     }
 }
 
-bool Circle::isSameSpot(const Shape &other) const {
-    const Circle *otherCircle = dynamic_cast<const Circle *>(&other);
-    return otherCircle && otherCircle->x == x && otherCircle->y == y && otherCircle->radius == radius;
+int SRectangle::getWidth() const {
+    return width;
 }
 
-std::string Circle::getType() const {
-    return "Circle";
+int SRectangle::getHeight() const {
+    return height;
 }
 
-int Circle::getRadius() const {
-    return radius;
+Rect SRectangle::boundsOf(int x, int y, int width, int height) {
+    if (width <= 0 || height <= 0) return {x, y, x, y};
+    return {x, y, saturate(static_cast<long long>(x) + width - 1), saturate(static_cast<long long>(y) + height - 1)};
 }
 
-bool Circle::isWithinBounds(int boardWidth, int boardHeight) const {
-    return x >= 0 && y >= 0 && x < boardWidth && y < boardHeight &&
-           radius <= (sqrt(pow(boardHeight, 2) + pow(boardWidth, 2)));
-}
-
-bool Circle::coversPoint(std::vector<std::vector<char>> &board, int x, int y) const {
-    int boardHeight = board.size();
-    int boardWidth = board[0].size();
-
-    for (int i = -radius; i <= radius; ++i) {
-        for (int j = -radius; j <= radius; ++j) {
-            int dist = i * i + j * j;
-            if ((getFillMode() && dist <= radius * radius) ||
-                (!getFillMode() && dist >= radius * radius - radius && dist <= radius * radius + radius)) {
-                int drawX = this->x + j;
-                int drawY = this->y + i;
-                if ((drawX >= 0 && drawX < boardWidth && drawY >= 0 && drawY < boardHeight) && drawY == y &&
-                    drawX == x)
-                    return true;
-            }
-        }
-    }
-    return false;
+bool SRectangle::fitsBoard(const ShapeRecord &r, int boardWidth, int boardHeight) {
+    return r.a <= boardWidth && r.b <= boardHeight;
 }
 
-Triangle::Triangle(int x, int y, char colour, bool fillMode, int h, int w) : Shape(x, y, colour, fillMode), height(h),
-                                                                             width(w) {}
+bool SRectangle::covers(int x, int y, int width, int height, bool fillMode, int px, int py) {
+    if (px < x || px > x + width - 1 || py < y || py > y + height - 1) return false;
 
-void Triangle::editSize(std::vector<float> sizes) {
-    if (sizes.size() == 2) {
-        this->width = int(sizes[0]);
-        this->height = int(sizes[1]);
-    } else {
-        std::cout << "Triangle requires 2 size parameters (width and height)." << std::endl;
-    }
+    return fillMode || px == x || px == x + width - 1 || py == y || py == y + height - 1;
 }
 
-void Triangle::draw(std::vector<std::vector<char>> &board) const {
-    int boardHeight = board.size();
-    int boardWidth = board[0].size();
+Circle::Circle(int x, int y, char colour, bool fillMode, int r)
+        : Shape(kind.tag, x, y, colour, fillMode), radius(r) {
+    bounds = boundsOf(x, y, radius);
+}
 
-    char symbol = getColour();
+void Circle::rasterizeSpans(int x, int y, int radius, bool fillMode, const Rect &clip, std::vector<Span> &spans) {
+    long long rr = static_cast<long long>(radius) * radius;
+    int top = std::max(-radius, clip.y0 - y);
+    int bottom = std::min(radius, clip.y1 - y);
+    if (top > bottom) return;
 
-    if (getFillMode()) {
-        for (int i = 0; i < height; ++i) {
-            int leftX = x - (i * width / height) / 2;
-            int rightX = x + (i * width / height) / 2;
-            int drawY = y + i;
+    // Half-widths for all rows at once, so the square roots run in vector lanes.
+    thread_local std::vector<int> outer, inner;
+    int rows = bottom - top + 1;
+    outer.resize(rows);
 
-            if (drawY >= 0 && drawY < boardHeight) {
-                for (int j = leftX; j <= rightX && j < boardWidth; ++j) {
-                    if (j >= 0) board[drawY][j] = symbol;
-                }
-            }
-        }
-    } else {
-        for (int i = 0; i < height; ++i) {
-            int leftX = x - (i * width / height) / 2;
-            int rightX = x + (i * width / height) / 2;
-            int drawY = y + i;
-
-            if (drawY >= 0 && drawY < boardHeight) {
-                if (leftX >= 0 && leftX < boardWidth) board[drawY][leftX] = colour;
-                if (rightX >= 0 && rightX < boardWidth) board[drawY][rightX] = colour;
-            }
+    if (fillMode) {
+        Simd::rowRoots(rr, top, rows, outer.data());
+        for (int k = 0; k < rows; ++k) {
+            addSpan(spans, y + top + k, x - outer[k], x + outer[k], clip);
         }
+        return;
+    }
 
-        for (int j = x - width / 2; j <= x + width / 2 && j < boardWidth; ++j) {
-            if (y + height - 1 >= 0 && y + height - 1 < boardHeight) {
-                board[y + height - 1][j] = colour;
-            }
+    // Ring cells satisfy rr - r <= i*i + j*j <= rr + r with |j| <= r.
+    inner.resize(rows);
+    Simd::rowRoots(rr + radius, top, rows, outer.data());
+    Simd::rowRoots(rr - radius, top, rows, inner.data());
+    for (int k = 0; k < rows; ++k) {
+        long long i = top + k;
+        int drawY = y + top + k;
+        int outerHalf = std::min(outer[k], radius);
+        // Round the inner root up: the smallest j with j*j >= rr - r - i*i.
+        int innerHalf = static_cast<long long>(inner[k]) * inner[k] < rr - radius - i * i ? inner[k] + 1 : inner[k];
+        if (innerHalf > outerHalf) continue;
+        if (innerHalf == 0) {
+            addSpan(spans, drawY, x - outerHalf, x + outerHalf, clip);
+        } else {
+            addSpan(spans, drawY, x - outerHalf, x - innerHalf, clip);
+            addSpan(spans, drawY, x + innerHalf, x + outerHalf, clip);
         }
     }
 }
 
-bool Triangle::isSameSpot(const Shape &other) const {
-    const Triangle *otherTriangle = dynamic_cast<const Triangle *>(&other);
-    return otherTriangle && otherTriangle->x == x && otherTriangle->y == y && otherTriangle->height == height;
+int Circle::getRadius() const {
+    return radius;
 }
 
-std::string Triangle::getType() const {
-    return "Triangle";
+Rect Circle::boundsOf(int x, int y, int radius) {
+    long long r = std::max(radius, 0);
+    return {saturate(x - r), saturate(y - r), saturate(x + r), saturate(y + r)};
 }
 
-int Triangle::getHeight() const {
-    return height;
+bool Circle::fitsBoard(const ShapeRecord &r, int boardWidth, int boardHeight) {
+    return r.a <= std::hypot(boardWidth, boardHeight);
 }
 
-int Triangle::getWidth() const {
-    return width;
+bool Circle::covers(int x, int y, int radius, bool fillMode, int px, int py) {
+    long long dx = px - x;
+    long long dy = py - y;
+    if (std::abs(dx) > radius || std::abs(dy) > radius) return false;
+
+    long long rr = static_cast<long long>(radius) * radius;
+    long long dist = dx * dx + dy * dy;
+    if (fillMode) return dist <= rr;
+    return dist >= rr - radius && dist <= rr + radius;
 }
 
-bool Triangle::isWithinBounds(int boardWidth, int boardHeight) const {
-    return x >= 0 && y >= 0 && x < boardWidth && y < boardHeight && width <= boardWidth && height <= boardHeight;
+int Triangle::rowHalfWidth(int row, int height, int width) {
+    // row * width overflows an int once the triangle is a few tens of thousands of cells a side.
+    return static_cast<int>(static_cast<long long>(row) * width / height / 2);
 }
 
-bool Triangle::coversPoint(std::vector<std::vector<char>> &board, int x, int y) const {
-    int boardHeight = board.size();
-    int boardWidth = board[0].size();
+Triangle::Triangle(int x, int y, char colour, bool fillMode, int h, int w)
+        : Shape(kind.tag, x, y, colour, fillMode), height(h), width(w) {
+    bounds = boundsOf(x, y, height, width);
+}
 
-    if (getFillMode()) {
-        for (int i = 0; i < height; ++i) {
-            int leftX = this->x - (i * width / height) / 2;
-            int rightX = this->x + (i * width / height) / 2;
-            int drawY = this->y + i;
+void Triangle::rasterizeSpans(int x, int y, int height, int width, bool fillMode, const Rect &clip,
+                              std::vector<Span> &spans) {
+    int first = std::max(0, clip.y0 - y);
+    int last = std::min(height, clip.y1 + 1 - y);
 
-            if (drawY >= 0 && drawY < boardHeight) {
-                for (int j = leftX; j <= rightX && j < boardWidth; ++j) {
-                    if ((j >= 0) && drawY == y && j == x) return true;
-                }
-            }
-        }
-    } else {
-        for (int i = 0; i < height; ++i) {
-            int leftX = this->x - (i * width / height) / 2;
-            int rightX = this->x + (i * width / height) / 2;
-            int drawY = this->y + i;
-
-            if (drawY >= 0 && drawY < boardHeight) {
-                if ((leftX >= 0 && leftX < boardWidth) && drawY == y && leftX == x) return true;
-                if ((rightX >= 0 && rightX < boardWidth) && drawY == y && rightX == x)return true;
-            }
-        }
+    for (int i = first; i < last; ++i) {
+        int half = rowHalfWidth(i, height, width);
+        int drawY = y + i;
 
-        for (int j = this->x - width / 2; j <= this->x + width / 2 && j < boardWidth; ++j) {
-            if (this->y + height - 1 >= 0 && this->y + height - 1 < boardHeight) {
-                if (this->y + height - 1 == y && j == x) return true;
-            }
+        if (fillMode) {
+            addSpan(spans, drawY, x - half, x + half, clip);
+        } else {
+            addSpan(spans, drawY, x - half, x - half, clip);
+            addSpan(spans, drawY, x + half, x + half, clip);
         }
     }
-    return false;
-}
 
-Line::Line(int x, int y, char colour, bool fillMode, int l, double a) : Shape(x, y, colour, fillMode), length(l),
-                                                                        angle(a) {}
-
-void Line::editSize(std::vector<float> sizes) {
-    if (sizes.size() == 2) {
-        this->length = int(sizes[0]);
-        this->angle = sizes[1];
-    } else {
-        std::cout << "Line requires 2 size parameters (length and angle)." << std::endl;
+    int baseY = y + height - 1;
+    if (!fillMode && baseY >= clip.y0 && baseY <= clip.y1) {
+        addSpan(spans, baseY, x - width / 2, x + width / 2, clip);
     }
 }
 
-void Line::draw(std::vector<std::vector<char>> &board) const {
-    int boardHeight = board.size();
-    int boardWidth = board[0].size();
+int Triangle::getHeight() const {
+    return height;
+}
 
-    char symbol = getColour();
+int Triangle::getWidth() const {
+    return width;
+}
 
-    double radAngle = angle * M_PI / 180.0;
+Rect Triangle::boundsOf(int x, int y, int height, int width) {
+    // No row is wider than the base, and the frame's base row sits at y + height - 1.
+    long long half = std::max(width, 0) / 2;
+    int baseY = saturate(static_cast<long long>(y) + height - 1);
+    return {saturate(x - half), std::min(y, baseY), saturate(x + half), std::max(y, baseY)};
+}
 
-    for (int i = 0; i < length; ++i) {
-        int drawX = x + static_cast<int>(i * cos(radAngle));
-        int drawY = y + static_cast<int>(i * sin(radAngle));
+bool Triangle::fitsBoard(const ShapeRecord &r, int boardWidth, int boardHeight) {
+    return r.b <= boardWidth && r.a <= boardHeight;
+}
 
-        if (drawX >= 0 && drawX < boardWidth && drawY >= 0 && drawY < boardHeight) {
-            board[drawY][drawX] = symbol;
-        }
+bool Triangle::covers(int x, int y, int height, int width, bool fillMode, int px, int py) {
+    int i = py - y;
+    if (i >= 0 && i < height) {
+        int half = rowHalfWidth(i, height, width);
+        if (fillMode && px >= x - half && px <= x + half) return true;
+        if (!fillMode && (px == x - half || px == x + half)) return true;
     }
+
+    return !fillMode && py == y + height - 1 && px >= x - width / 2 && px <= x + width / 2;
 }
 
-bool Line::isSameSpot(const Shape &other) const {
-    const Line *otherLine = dynamic_cast<const Line *>(&other);
-    return otherLine && otherLine->x == x && otherLine->y == y && otherLine->length == length;
+Line::Line(int x, int y, char colour, bool fillMode, int l, double a)
+        : Shape(kind.tag, x, y, colour, fillMode), length(l), angle(a) {
+    bounds = boundsOf(x, y, length, angle);
 }
 
-std::string Line::getType() const {
-    return "Line";
+void Line::rasterizeSpans(int x, int y, int length, double angle, const Rect &clip, std::vector<Span> &spans) {
+    if (length <= 0) return;
+
+    int endX, endY;
+    endpointOf(x, y, length, angle, endX, endY);
+    int dx = std::abs(endX - x), dy = std::abs(endY - y);
+    int sx = endX < x ? -1 : 1, sy = endY < y ? -1 : 1;
+    int first, last;
+
+    if (dx >= dy) {
+        // One cell per column; the cells of a row form one run and go out as one span.
+        if (!stepRange(x, sx, dx, clip.x0, clip.x1, first, last)) return;
+        long long rowLo = sy > 0 ? clip.y0 - y : y - clip.y1, rowHi = sy > 0 ? clip.y1 - y : y - clip.y0;
+        if (!minorRange(dx, dy, rowLo, rowHi, first, last)) return;
+        long long offset = minorOffset(dx, dy, first);
+        long long error = (dx + 2LL * first * dy) % (2LL * std::max(dx, 1));
+        int runStart = first;
+
+        for (int i = first; i <= last; ++i) {
+            error += 2LL * dy;
+            if (error < 2LL * dx && i != last) continue;
+
+            // Cell i ends its row.
+            int drawY = y + sy * static_cast<int>(offset);
+            if (drawY >= clip.y0 && drawY <= clip.y1) {
+                int x0 = x + sx * runStart, x1 = x + sx * i;
+                addSpan(spans, drawY, std::min(x0, x1), std::max(x0, x1), clip);
+            }
+            error -= 2LL * dx;
+            ++offset;
+            runStart = i + 1;
+        }
+    } else {
+        // One cell per row.
+        if (!stepRange(y, sy, dy, clip.y0, clip.y1, first, last)) return;
+        long long offset = minorOffset(dy, dx, first);
+        long long error = (dy + 2LL * first * dx) % (2LL * dy);
+
+        for (int i = first; i <= last; ++i) {
+            if (i != first) {
+                error += 2LL * dx;
+                if (error >= 2LL * dy) {
+                    error -= 2LL * dy;
+                    ++offset;
+                }
+            }
+            int drawX = x + sx * static_cast<int>(offset);
+            addSpan(spans, y + sy * i, drawX, drawX, clip);
+        }
+    }
 }
 
 double Line::getAngle() const {
@@ -320,25 +380,39 @@ int Line::getLength() const {
     return length;
 }
 
-bool Line::isWithinBounds(int boardWidth, int boardHeight) const {
+Rect Line::boundsOf(int x, int y, int length, double angle) {
+    if (length <= 0) return {x, y, x, y};
 
-    return x >= 0 && y >= 0 && x < boardWidth && y < boardHeight &&
-           length <= (sqrt(pow(boardHeight, 2) + pow(boardWidth, 2)));
+    int endX, endY;
+    endpointOf(x, y, length, angle, endX, endY);
+    return {std::min(x, endX), std::min(y, endY), std::max(x, endX), std::max(y, endY)};
 }
 
-bool Line::coversPoint(std::vector<std::vector<char>> &board, int x, int y) const {
-    int boardHeight = board.size();
-    int boardWidth = board[0].size();
+bool Line::fitsBoard(const ShapeRecord &r, int boardWidth, int boardHeight) {
+    return r.a <= std::hypot(boardWidth, boardHeight);
+}
 
+void Line::endpointOf(int x, int y, int length, double angle, int &endX, int &endY) {
     double radAngle = angle * M_PI / 180.0;
+    int steps = std::max(length - 1, 0);
+    endX = saturate(x + std::llround(steps * std::cos(radAngle)));
+    endY = saturate(y + std::llround(steps * std::sin(radAngle)));
+}
 
-    for (int i = 0; i < length; ++i) {
-        int drawX = x + static_cast<int>(i * cos(radAngle));
-        int drawY = y + static_cast<int>(i * sin(radAngle));
+bool Line::covers(int x, int y, int length, double angle, int px, int py) {
+    if (length <= 0) return false;
 
-        if (drawX >= 0 && drawX < boardWidth && drawY >= 0 && drawY < boardHeight) {
-            if (drawY == y && drawX == x) return true;
-        }
+    int endX, endY;
+    endpointOf(x, y, length, angle, endX, endY);
+    int dx = std::abs(endX - x), dy = std::abs(endY - y);
+    int sx = endX < x ? -1 : 1, sy = endY < y ? -1 : 1;
+
+    // The point's major coordinate picks the step; the line covers it if the minor one matches.
+    if (dx >= dy) {
+        long long i = static_cast<long long>(px - x) * sx;
+        return i >= 0 && i <= dx && py == y + sy * minorOffset(dx, dy, i);
     }
-    return false;
+    long long i = static_cast<long long>(py - y) * sy;
+    return i >= 0 && i <= dy && px == x + sx * minorOffset(dy, dx, i);
 }
+
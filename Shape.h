@@ -1,43 +1,118 @@
 #ifndef SHAPE_H
 #define SHAPE_H
 
+#include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
-#include <cmath>
-#include <sstream>
+#include "Framebuffer.h"
+#include "ShapePool.h"
+
+// Plain-data form of a shape used by the scene file formats. tag is the shape type's kind.tag; a
+// and b hold the integer size parameters and c the real one (the Line angle), as the type's
+// parameter schema assigns them.
+struct ShapeRecord {
+    std::uint8_t tag;
+    char colour;
+    bool fillMode;
+    int x, y, a, b;
+    double c;
+};
+
+// One size parameter of a shape type, in the order the add command and the text format take them.
+struct ShapeParam {
+    enum Field : unsigned char {
+        A,
+        B,
+        C
+    };
+
+    std::string_view name;
+    Field field;
+    // Two shapes of a type are on the same spot when their anchors and identifying parameters match.
+    bool identifies;
+    // The value must be above zero. ShapeRegistry::invalidParam applies it for add, edit and load.
+    bool positive;
+};
+
+// Everything the registry needs to know about a shape type besides its geometry. Every type
+// declares one as its static constexpr member kind; tags number the types from 1 in registry order
+// and are what the binary format stores, so they must never change.
+struct ShapeKind {
+    static constexpr std::size_t maxParams = 3;
+
+    std::uint8_t tag;
+    // name is used by the text format and listings, command by the add command.
+    std::string_view name, command;
+    bool hasFill;
+    std::size_t paramCount;
+    ShapeParam params[maxParams];
+};
 
+// Shapes dispatch on their tag through ShapeRegistry rather than on virtual calls or RTTI. Each
+// type defines its kind, a constructor from a ShapeRecord, toRecord, and static geometry kernels on
+// records: rasterizeSpans, covers, boundsOf and fitsBoard, which says whether a shape of that size
+// is allowed on the board at all, whatever its anchor.
 class Shape {
 protected:
+    std::uint8_t tag;
     int x, y;
     char colour;
     bool fillMode;
+    // Cells the shape can touch. Subclasses set it on construction; editSize and editPosition keep
+    // it up to date.
+    Rect bounds;
 
-    Shape(int x, int y, char colour, bool fillMode);
+    Shape(std::uint8_t tag, int x, int y, char colour, bool fillMode);
 
 public:
 
     virtual ~Shape() = default;
 
     void editPosition(int nx, int ny) {
+        bounds = {bounds.x0 + nx - x, bounds.y0 + ny - y, bounds.x1 + nx - x, bounds.y1 + ny - y};
         x = nx;
         y = ny;
     };
 
-    virtual void editSize(std::vector<float> sizes) = 0;
+    // Takes the size parameters in the order of the type's schema. Reports a wrong count or a value
+    // the schema rejects and returns false, leaving the shape as it was.
+    bool editSize(const float *sizes, std::size_t count);
+
+    void rasterize(const Rect &clip, std::vector<Span> &spans) const;
 
-    virtual void draw(std::vector<std::vector<char>> &board) const = 0;
+    void draw(Framebuffer &board) const;
 
-    virtual bool isSameSpot(const Shape &other) const = 0;
+    void draw(Framebuffer &board, const Rect &clip) const;
 
-    virtual bool isWithinBounds(int boardWidth, int boardHeight) const = 0;
+    bool isSameSpot(const Shape &other) const;
 
-    virtual std::string getType() const = 0;
+    // The anchor must be on the board and the type's fitsBoard must accept the size: rectangles and
+    // triangles no wider or taller than the board, circles and lines no bigger than its diagonal.
+    bool isWithinBounds(int boardWidth, int boardHeight) const;
+
+    const Rect &getBounds() const {
+        return bounds;
+    }
 
-    virtual bool coversPoint(std::vector<std::vector<char>> &board, int x, int y) const = 0;
+    std::uint8_t getTag() const {
+        return tag;
+    }
 
-    virtual std::string describe() const = 0;
+    std::string_view getType() const;
 
-    virtual void serialize(std::ostream &os) const = 0;
+    bool coversPoint(const Framebuffer &board, int x, int y) const;
+
+    std::string describe() const;
+
+    std::shared_ptr<Shape> clone() const;
+
+    void serialize(std::ostream &os) const;
+
+    virtual ShapeRecord toRecord() const = 0;
 
     std::pair<int, int> getPosition() const;
 
@@ -57,34 +132,44 @@ private:
     int width, height;
 
 public:
+    static constexpr ShapeKind kind{1, "Rectangle", "rectangle", true, 2,
+                                    {{"width", ShapeParam::A, true, true}, {"height", ShapeParam::B, true, true}}};
+
     SRectangle(int x, int y, char colour, bool fillMode, int w, int h);
 
-    virtual void editSize(std::vector<float> sizes) override;
+    explicit SRectangle(const ShapeRecord &record)
+            : SRectangle(record.x, record.y, record.colour, record.fillMode, record.a, record.b) {}
 
-    void draw(std::vector<std::vector<char>> &board) const override;
+    ShapeRecord toRecord() const override {
+        return {kind.tag, colour, fillMode, x, y, width, height, 0.0};
+    }
 
-    bool isSameSpot(const Shape &other) const override;
+    int getWidth() const;
 
-    std::string getType() const override;
+    int getHeight() const;
 
-    bool coversPoint(std::vector<std::vector<char>> &board, int x, int y) const override;
+    // Geometry kernels on plain parameters. The registry and SceneStore call them through the
+    // record overloads.
+    static void rasterizeSpans(int x, int y, int width, int height, bool fillMode, const Rect &clip,
+                               std::vector<Span> &spans);
 
-    std::string describe() const override {
-        std::ostringstream oss;
-        oss << "Width: " << width << ", Height: " << height;
-        return oss.str();
-    }
+    static bool covers(int x, int y, int width, int height, bool fillMode, int px, int py);
+
+    static Rect boundsOf(int x, int y, int width, int height);
 
-    void serialize(std::ostream &os) const override {
-        os << getType() << ' ' << getPosition().first << ' ' << getPosition().second << ' '
-           << getColour() << ' ' << getFillMode() << ' ' << width << ' ' << height << '\n';
+    static void rasterizeSpans(const ShapeRecord &r, const Rect &clip, std::vector<Span> &spans) {
+        rasterizeSpans(r.x, r.y, r.a, r.b, r.fillMode, clip, spans);
     }
 
-    int getWidth() const;
+    static bool covers(const ShapeRecord &r, int px, int py) {
+        return covers(r.x, r.y, r.a, r.b, r.fillMode, px, py);
+    }
 
-    int getHeight() const;
+    static Rect boundsOf(const ShapeRecord &r) {
+        return boundsOf(r.x, r.y, r.a, r.b);
+    }
 
-    bool isWithinBounds(int boardWidth, int boardHeight) const;
+    static bool fitsBoard(const ShapeRecord &r, int boardWidth, int boardHeight);
 };
 
 class Circle : public Shape {
@@ -92,32 +177,37 @@ private:
     int radius;
 
 public:
+    static constexpr ShapeKind kind{2, "Circle", "circle", true, 1, {{"radius", ShapeParam::A, true, true}}};
+
     Circle(int x, int y, char colour, bool fillMode, int r);
 
-    virtual void editSize(std::vector<float> sizes) override;
+    explicit Circle(const ShapeRecord &record) : Circle(record.x, record.y, record.colour, record.fillMode, record.a) {}
+
+    ShapeRecord toRecord() const override {
+        return {kind.tag, colour, fillMode, x, y, radius, 0, 0.0};
+    }
 
-    void draw(std::vector<std::vector<char>> &board) const override;
+    int getRadius() const;
 
-    bool isSameSpot(const Shape &other) const override;
+    static void rasterizeSpans(int x, int y, int radius, bool fillMode, const Rect &clip, std::vector<Span> &spans);
 
-    std::string getType() const override;
+    static bool covers(int x, int y, int radius, bool fillMode, int px, int py);
 
-    bool coversPoint(std::vector<std::vector<char>> &board, int x, int y) const override;
+    static Rect boundsOf(int x, int y, int radius);
 
-    std::string describe() const override {
-        std::ostringstream oss;
-        oss << "Radius: " << radius;
-        return oss.str();
+    static void rasterizeSpans(const ShapeRecord &r, const Rect &clip, std::vector<Span> &spans) {
+        rasterizeSpans(r.x, r.y, r.a, r.fillMode, clip, spans);
     }
 
-    void serialize(std::ostream &os) const override {
-        os << getType() << ' ' << getPosition().first << ' ' << getPosition().second << ' '
-           << getColour() << ' ' << getFillMode() << ' ' << radius << '\n';
+    static bool covers(const ShapeRecord &r, int px, int py) {
+        return covers(r.x, r.y, r.a, r.fillMode, px, py);
     }
 
-    int getRadius() const;
+    static Rect boundsOf(const ShapeRecord &r) {
+        return boundsOf(r.x, r.y, r.a);
+    }
 
-    bool isWithinBounds(int boardWidth, int boardHeight) const;
+    static bool fitsBoard(const ShapeRecord &r, int boardWidth, int boardHeight);
 };
 
 class Triangle : public Shape {
@@ -125,35 +215,46 @@ private:
     int height;
     int width;
 
+    // Half the width of row row below the apex, shared by the rasterizer and the point test.
+    static int rowHalfWidth(int row, int height, int width);
+
 public:
+    static constexpr ShapeKind kind{3, "Triangle", "triangle", true, 2,
+                                    {{"height", ShapeParam::A, true, true}, {"width", ShapeParam::B, false, true}}};
+
     Triangle(int x, int y, char colour, bool fillMode, int h, int w);
 
-    void editSize(std::vector<float> sizes) override;
+    explicit Triangle(const ShapeRecord &record)
+            : Triangle(record.x, record.y, record.colour, record.fillMode, record.a, record.b) {}
+
+    ShapeRecord toRecord() const override {
+        return {kind.tag, colour, fillMode, x, y, height, width, 0.0};
+    }
+
+    int getHeight() const;
 
-    void draw(std::vector<std::vector<char>> &board) const override;
+    int getWidth() const;
 
-    bool isSameSpot(const Shape &other) const override;
+    static void rasterizeSpans(int x, int y, int height, int width, bool fillMode, const Rect &clip,
+                               std::vector<Span> &spans);
 
-    std::string getType() const override;
+    static bool covers(int x, int y, int height, int width, bool fillMode, int px, int py);
 
-    bool coversPoint(std::vector<std::vector<char>> &board, int x, int y) const override;
+    static Rect boundsOf(int x, int y, int height, int width);
 
-    std::string describe() const override {
-        std::ostringstream oss;
-        oss << "Width: " << width << ", Height: " << height;
-        return oss.str();
+    static void rasterizeSpans(const ShapeRecord &r, const Rect &clip, std::vector<Span> &spans) {
+        rasterizeSpans(r.x, r.y, r.a, r.b, r.fillMode, clip, spans);
     }
 
-    void serialize(std::ostream &os) const override {
-        os << getType() << ' ' << getPosition().first << ' ' << getPosition().second << ' '
-           << getColour() << ' ' << getFillMode() << ' ' << height << ' ' << width << '\n';
+    static bool covers(const ShapeRecord &r, int px, int py) {
+        return covers(r.x, r.y, r.a, r.b, r.fillMode, px, py);
     }
 
-    int getHeight() const;
-
-    int getWidth() const;
+    static Rect boundsOf(const ShapeRecord &r) {
+        return boundsOf(r.x, r.y, r.a, r.b);
+    }
 
-    bool isWithinBounds(int boardWidth, int boardHeight) const;
+    static bool fitsBoard(const ShapeRecord &r, int boardWidth, int boardHeight);
 };
 
 class Line : public Shape {
@@ -162,34 +263,44 @@ private:
     double angle;
 
 public:
+    static constexpr ShapeKind kind{4, "Line", "line", false, 2,
+                                    {{"length", ShapeParam::A, true, true}, {"angle", ShapeParam::C, false, false}}};
+
     Line(int x, int y, char colour, bool fillMode, int l, double a);
 
-    void editSize(std::vector<float> sizes) override;
+    explicit Line(const ShapeRecord &record)
+            : Line(record.x, record.y, record.colour, record.fillMode, record.a, record.c) {}
 
-    void draw(std::vector<std::vector<char>> &board) const override;
+    ShapeRecord toRecord() const override {
+        return {kind.tag, colour, fillMode, x, y, length, 0, angle};
+    }
 
-    bool isSameSpot(const Shape &other) const override;
+    int getLength() const;
 
-    std::string getType() const override;
+    double getAngle() const;
 
-    bool coversPoint(std::vector<std::vector<char>> &board, int x, int y) const override;
+    static void rasterizeSpans(int x, int y, int length, double angle, const Rect &clip, std::vector<Span> &spans);
 
-    std::string describe() const override {
-        std::ostringstream oss;
-        oss << "Length: " << length << ", Angle: " << angle;
-        return oss.str();
-    }
+    static bool covers(int x, int y, int length, double angle, int px, int py);
 
-    void serialize(std::ostream &os) const override {
-        os << getType() << ' ' << getPosition().first << ' ' << getPosition().second << ' '
-           << getColour() << ' ' << getFillMode() << ' ' << length << ' ' << angle << '\n';
+    static Rect boundsOf(int x, int y, int length, double angle);
+
+    // Last cell of the line: (length - 1) steps from the origin along angle, rounded to the grid.
+    static void endpointOf(int x, int y, int length, double angle, int &endX, int &endY);
+
+    static void rasterizeSpans(const ShapeRecord &r, const Rect &clip, std::vector<Span> &spans) {
+        rasterizeSpans(r.x, r.y, r.a, r.c, clip, spans);
     }
 
-    int getLength() const;
+    static bool covers(const ShapeRecord &r, int px, int py) {
+        return covers(r.x, r.y, r.a, r.c, px, py);
+    }
 
-    double getAngle() const;
+    static Rect boundsOf(const ShapeRecord &r) {
+        return boundsOf(r.x, r.y, r.a, r.c);
+    }
 
-    bool isWithinBounds(int boardWidth, int boardHeight) const;
+    static bool fitsBoard(const ShapeRecord &r, int boardWidth, int boardHeight);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <new>
+#include "ShapePool.h"
+#include "Stats.h"
+
+std::mutex BlockPool::registryMutex;
+
+std::vector<BlockPool *> &BlockPool::registry() {
+    static std::vector<BlockPool *> pools;
+    return pools;
+}
+
+BlockPool::BlockPool(std::size_t blockSize)
+        : blockSize(std::max(blockSize, sizeof(FreeBlock))), chunkSize(chunkBytes) {
+    // Chunks double until one holds a block after its header; the mask in headerOf needs a power of two.
+    while (chunkSize - headerBytes < this->blockSize) chunkSize *= 2;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    registry().push_back(this);
+}
+
+BlockPool::~BlockPool() {
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto &pools = registry();
+        pools.erase(std::remove(pools.begin(), pools.end(), this), pools.end());
+    }
+    for (char *chunk: chunks) {
+        ::operator delete[](chunk, std::align_val_t(chunkSize));
+    }
+}
+
+void *BlockPool::allocate() {
+    STATS_ADD(POOL_ALLOCATIONS, 1);
+    std::lock_guard<std::mutex> lock(mutex);
+    void *block;
+    if (freeList) {
+        block = freeList;
+        freeList = freeList->next;
+    } else {
+        if (bump == bumpEnd) {
+            char *chunk = static_cast<char *>(::operator new[](chunkSize, std::align_val_t(chunkSize)));
+            new(chunk) ChunkHeader{0};
+            chunks.push_back(chunk);
+            bump = chunk + headerBytes;
+            bumpEnd = bump + (chunkSize - headerBytes) / blockSize * blockSize;
+            STATS_ADD(POOL_CHUNKS, 1);
+        }
+        block = bump;
+        bump += blockSize;
+    }
+    ++headerOf(block)->live;
+    return block;
+}
+
+void BlockPool::deallocate(void *block) {
+    STATS_ADD(POOL_RELEASES, 1);
+    std::lock_guard<std::mutex> lock(mutex);
+    --headerOf(block)->live;
+    auto *freed = static_cast<FreeBlock *>(block);
+    freed->next = freeList;
+    freeList = freed;
+}
+
+void BlockPool::releaseChunk(char *chunk) {
+    if (bump > chunk && bump <= chunk + chunkSize) bump = bumpEnd = nullptr;
+    ::operator delete[](chunk, std::align_val_t(chunkSize));
+    STATS_ADD(POOL_CHUNKS_RELEASED, 1);
+}
+
+void BlockPool::trim() {
+    std::lock_guard<std::mutex> lock(mutex);
+    // Unlink the free blocks of empty chunks before the chunks go.
+    for (FreeBlock **link = &freeList; *link;) {
+        if (headerOf(*link)->live == 0) {
+            *link = (*link)->next;
+        } else {
+            link = &(*link)->next;
+        }
+    }
+    auto empty = std::partition(chunks.begin(), chunks.end(), [](char *chunk) {
+        return reinterpret_cast<ChunkHeader *>(chunk)->live != 0;
+    });
+    std::for_each(empty, chunks.end(), [this](char *chunk) { releaseChunk(chunk); });
+    chunks.erase(empty, chunks.end());
+}
+
+void BlockPool::trimAll() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (BlockPool *pool: registry()) {
+        pool->trim();
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef SHAPEPOOL_H
+#define SHAPEPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Fixed-size blocks carved out of 64 KiB chunks. Freed blocks go on a free list and are handed out
+// again before the chunk is bumped further, so allocating and releasing a block are O(1) and never
+// reach the system allocator once the pool is warm. Chunks are aligned to their size and count their
+// live blocks in a header, so trim can hand the ones left empty back to the system.
+class BlockPool {
+private:
+    static constexpr std::size_t chunkBytes = 64 * 1024;
+    static constexpr std::size_t headerBytes = alignof(std::max_align_t);
+
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    struct ChunkHeader {
+        std::size_t live;
+    };
+
+    std::size_t blockSize, chunkSize;
+    std::mutex mutex;
+    FreeBlock *freeList = nullptr;
+    char *bump = nullptr, *bumpEnd = nullptr;
+    std::vector<char *> chunks;
+
+    ChunkHeader *headerOf(void *block) const {
+        return reinterpret_cast<ChunkHeader *>(reinterpret_cast<std::uintptr_t>(block) & ~(chunkSize - 1));
+    }
+
+    void releaseChunk(char *chunk);
+
+    // Every pool made by forSize, for trimAll.
+    static std::mutex registryMutex;
+    static std::vector<BlockPool *> &registry();
+
+public:
+    explicit BlockPool(std::size_t blockSize);
+
+    ~BlockPool();
+
+    BlockPool(const BlockPool &) = delete;
+
+    BlockPool &operator=(const BlockPool &) = delete;
+
+    void *allocate();
+
+    void deallocate(void *block);
+
+    // Releases the chunks with no live blocks. O(free blocks + chunks).
+    void trim();
+
+    // Trims every pool. Called when a scene is dropped, when many blocks go free at once.
+    static void trimAll();
+
+    // One pool per block size, shared by every type that rounds up to it.
+    template<std::size_t Size, std::size_t Align>
+    static BlockPool &forSize() {
+        static_assert(Align <= alignof(std::max_align_t), "BlockPool blocks are only max_align_t aligned");
+        constexpr std::size_t unit = alignof(std::max_align_t);
+        static BlockPool pool((Size + unit - 1) / unit * unit);
+        return pool;
+    }
+};
+
+// Standard allocator over BlockPool for single objects; arrays fall back to the heap. With
+// std::allocate_shared the shape and its control block share one pooled block.
+template<typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    PoolAllocator() = default;
+
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U> &) {}
+
+    T *allocate(std::size_t n) {
+        if (n != 1) return std::allocator<T>().allocate(n);
+        return static_cast<T *>(BlockPool::forSize<sizeof(T), alignof(T)>().allocate());
+    }
+
+    void deallocate(T *p, std::size_t n) {
+        if (n != 1) {
+            std::allocator<T>().deallocate(p, n);
+        } else {
+            BlockPool::forSize<sizeof(T), alignof(T)>().deallocate(p);
+        }
+    }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U> &) const {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const PoolAllocator<U> &) const {
+        return false;
+    }
+};
+
+// make_shared for shapes, from the pools.
+template<typename T, typename... Args>
+std::shared_ptr<T> makePooled(Args &&... args) {
+    return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+}
+
+#endif
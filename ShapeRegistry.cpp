@@ -0,0 +1,131 @@
+#include <cctype>
+#include <cmath>
+#include "CommandParser.h"
+#include "ShapeRegistry.h"
+
+namespace {
+    // Integer parameters print as integers, however large.
+    void writeParam(std::ostream &os, const ShapeRecord &record, const ShapeParam &param) {
+        switch (param.field) {
+            case ShapeParam::A:
+                os << record.a;
+                break;
+            case ShapeParam::B:
+                os << record.b;
+                break;
+            case ShapeParam::C:
+                os << record.c;
+                break;
+        }
+    }
+}
+
+const ShapeKind *ShapeRegistry::findName(std::string_view name) {
+    for (const auto &kind: Types::kinds) {
+        if (kind.name == name) return &kind;
+    }
+    return nullptr;
+}
+
+const ShapeKind *ShapeRegistry::findCommand(std::string_view command) {
+    for (const auto &kind: Types::kinds) {
+        if (kind.command == command) return &kind;
+    }
+    return nullptr;
+}
+
+std::shared_ptr<Shape> ShapeRegistry::make(const ShapeRecord &record) {
+    return visit(record.tag, [&](auto type) -> std::shared_ptr<Shape> {
+        return makePooled<typename decltype(type)::type>(record);
+    });
+}
+
+bool ShapeRegistry::sameSpot(const ShapeRecord &a, const ShapeRecord &b) {
+    if (a.tag != b.tag || a.x != b.x || a.y != b.y) return false;
+
+    const ShapeKind &kind = kindOf(a.tag);
+    for (std::size_t i = 0; i < kind.paramCount; ++i) {
+        if (kind.params[i].identifies && param(a, kind.params[i]) != param(b, kind.params[i])) return false;
+    }
+    return true;
+}
+
+double ShapeRegistry::param(const ShapeRecord &record, const ShapeParam &param) {
+    switch (param.field) {
+        case ShapeParam::A:
+            return record.a;
+        case ShapeParam::B:
+            return record.b;
+        case ShapeParam::C:
+            return record.c;
+    }
+    return 0.0;
+}
+
+void ShapeRegistry::setParam(ShapeRecord &record, const ShapeParam &param, double value) {
+    switch (param.field) {
+        case ShapeParam::A:
+            record.a = static_cast<int>(value);
+            break;
+        case ShapeParam::B:
+            record.b = static_cast<int>(value);
+            break;
+        case ShapeParam::C:
+            record.c = value;
+            break;
+    }
+}
+
+const ShapeParam *ShapeRegistry::invalidParam(const ShapeRecord &record) {
+    const ShapeKind &kind = kindOf(record.tag);
+    for (std::size_t i = 0; i < kind.paramCount; ++i) {
+        double value = param(record, kind.params[i]);
+        // Binary scenes store c as raw bits, so a NaN or infinity can arrive without any parsing.
+        if (!std::isfinite(value) || (kind.params[i].positive && value <= 0)) return &kind.params[i];
+    }
+    return nullptr;
+}
+
+bool ShapeRegistry::parseParams(CommandParser &parser, ShapeRecord &record) {
+    const ShapeKind &kind = kindOf(record.tag);
+    for (std::size_t i = 0; i < kind.paramCount; ++i) {
+        switch (kind.params[i].field) {
+            case ShapeParam::A:
+                if (!parser.next(record.a)) return false;
+                break;
+            case ShapeParam::B:
+                if (!parser.next(record.b)) return false;
+                break;
+            case ShapeParam::C:
+                if (!parser.next(record.c)) return false;
+                break;
+        }
+    }
+    return true;
+}
+
+void ShapeRegistry::writeText(std::ostream &os, const ShapeRecord &record) {
+    const ShapeKind &kind = kindOf(record.tag);
+    os << kind.name << ' ' << record.x << ' ' << record.y << ' ' << record.colour << ' ' << record.fillMode;
+    for (std::size_t i = 0; i < kind.paramCount; ++i) {
+        os << ' ';
+        writeParam(os, record, kind.params[i]);
+    }
+}
+
+void ShapeRegistry::describe(std::ostream &os, const ShapeRecord &record) {
+    const ShapeKind &kind = kindOf(record.tag);
+    for (std::size_t i = 0; i < kind.paramCount; ++i) {
+        std::string_view name = kind.params[i].name;
+        os << (i ? ", " : "") << static_cast<char>(std::toupper(static_cast<unsigned char>(name[0])))
+           << name.substr(1) << ": ";
+        writeParam(os, record, kind.params[i]);
+    }
+}
+
+void ShapeRegistry::writeUsage(std::ostream &os, const ShapeKind &kind) {
+    os << kind.command << " <x> <y> <colour>" << (kind.hasFill ? " <fill/frame>" : "");
+    for (std::size_t i = 0; i < kind.paramCount; ++i) {
+        os << " <" << kind.params[i].name << '>';
+    }
+}
@@ -0,0 +1,130 @@
+#ifndef SHAPEREGISTRY_H
+#define SHAPEREGISTRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Shape.h"
+
+class CommandParser;
+
+// Stands in for a shape type when visiting, so the visitor gets the type without an object.
+template<class T>
+struct ShapeType {
+    using type = T;
+};
+
+template<class... Types>
+struct ShapeList {
+    static constexpr std::size_t count = sizeof...(Types);
+    static constexpr ShapeKind kinds[count] = {Types::kind...};
+
+    static constexpr bool tagsInOrder() {
+        for (std::size_t i = 0; i < count; ++i) {
+            if (kinds[i].tag != i + 1) return false;
+        }
+        return true;
+    }
+
+    // Calls f(ShapeType<T>{}) for the type T with this tag through a table with one entry per type,
+    // the way std::visit dispatches on a variant. tag must be registered.
+    template<class F>
+    static decltype(auto) visit(std::uint8_t tag, F &&f) {
+        using Result = std::common_type_t<decltype(f(ShapeType<Types>{}))...>;
+        using Call = Result (*)(F &);
+        static constexpr Call table[count] = {&call<Types, F, Result>...};
+        return table[tag - 1](f);
+    }
+
+private:
+    template<class T, class F, class Result>
+    static Result call(F &f) {
+        return f(ShapeType<T>{});
+    }
+};
+
+// The shape types, in tag order. A new type is its class and its place at the end of this list;
+// parsing, saving, listing, duplicate checks and rendering all work from the list.
+class ShapeRegistry {
+public:
+    using Types = ShapeList<SRectangle, Circle, Triangle, Line>;
+
+    static_assert(Types::tagsInOrder(), "Shape tags must number the registered types from 1 in order.");
+
+    static constexpr std::size_t count = Types::count;
+
+    static bool contains(std::uint8_t tag) {
+        return tag >= 1 && tag <= count;
+    }
+
+    static const ShapeKind &kindOf(std::uint8_t tag) {
+        return Types::kinds[tag - 1];
+    }
+
+    // Null when no type has that name or add command.
+    static const ShapeKind *findName(std::string_view name);
+
+    static const ShapeKind *findCommand(std::string_view command);
+
+    template<class F>
+    static decltype(auto) visit(std::uint8_t tag, F &&f) {
+        return Types::visit(tag, std::forward<F>(f));
+    }
+
+    static void rasterize(const ShapeRecord &record, const Rect &clip, std::vector<Span> &spans) {
+        visit(record.tag, [&](auto type) {
+            decltype(type)::type::rasterizeSpans(record, clip, spans);
+        });
+    }
+
+    static bool covers(const ShapeRecord &record, int px, int py) {
+        return visit(record.tag, [&](auto type) {
+            return decltype(type)::type::covers(record, px, py);
+        });
+    }
+
+    static Rect boundsOf(const ShapeRecord &record) {
+        return visit(record.tag, [&](auto type) {
+            return decltype(type)::type::boundsOf(record);
+        });
+    }
+
+    static bool fitsBoard(const ShapeRecord &record, int boardWidth, int boardHeight) {
+        return visit(record.tag, [&](auto type) {
+            return decltype(type)::type::fitsBoard(record, boardWidth, boardHeight);
+        });
+    }
+
+    static std::shared_ptr<Shape> make(const ShapeRecord &record);
+
+    // Same type, same anchor and equal identifying parameters.
+    static bool sameSpot(const ShapeRecord &a, const ShapeRecord &b);
+
+    static double param(const ShapeRecord &record, const ShapeParam &param);
+
+    // Integer parameters are truncated.
+    static void setParam(ShapeRecord &record, const ShapeParam &param, double value);
+
+    // The first parameter that is not finite or breaks its schema rule, or null when they all hold. Every way a
+    // shape comes in goes through this, so the rules live in the schema alone.
+    static const ShapeParam *invalidParam(const ShapeRecord &record);
+
+    // Reads the size parameters of the record's type, in schema order.
+    static bool parseParams(CommandParser &parser, ShapeRecord &record);
+
+    // One shape line of the text format, without the line break.
+    static void writeText(std::ostream &os, const ShapeRecord &record);
+
+    // "Width: 10, Height: 6" for the listing.
+    static void describe(std::ostream &os, const ShapeRecord &record);
+
+    // "circle <x> <y> <colour> <fill/frame> <radius>" for the help text.
+    static void writeUsage(std::ostream &os, const ShapeKind &kind);
+};
+
+#endif
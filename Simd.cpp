@@ -0,0 +1,290 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "Simd.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SBB_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define SBB_TARGET_SSE2
+#define SBB_TARGET_AVX2
+#else
+#define SBB_TARGET_SSE2 __attribute__((target("sse2")))
+#define SBB_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+    struct Kernels {
+        void (*fill)(char *, char, std::size_t);
+        void (*rowRoots)(long long, int, int, int *);
+        std::size_t (*runLength)(const char *, std::size_t, char, char);
+        void (*expandCells)(const char *, std::size_t, char *);
+        void (*overlay)(char *, const char *, std::size_t);
+    };
+
+    // Turns an estimate of floor(sqrt(value)) into the exact root. Estimates from double precision
+    // sqrt are off by at most one, but a converted value out of int range comes back negative.
+    int fixRoot(long long value, int estimate) {
+        if (value <= 0) return 0;
+        long long root = estimate;
+        if (root < 0) root = static_cast<long long>(std::sqrt(static_cast<double>(value)));
+        while (root * root > value) --root;
+        while ((root + 1) * (root + 1) <= value) ++root;
+        return static_cast<int>(root);
+    }
+
+    void fixRoots(long long base, int first, int count, int *roots) {
+        for (int k = 0; k < count; ++k) {
+            long long i = static_cast<long long>(first) + k;
+            roots[k] = fixRoot(base - i * i, roots[k]);
+        }
+    }
+
+    void fillScalar(char *dst, char value, std::size_t count) {
+        std::memset(dst, value, count);
+    }
+
+    void rowRootsScalar(long long base, int first, int count, int *roots) {
+        for (int k = 0; k < count; ++k) {
+            long long i = static_cast<long long>(first) + k;
+            long long value = base - i * i;
+            roots[k] = value > 0 ? static_cast<int>(std::sqrt(static_cast<double>(value))) : 0;
+        }
+        fixRoots(base, first, count, roots);
+    }
+
+    std::size_t runLengthScalar(const char *cells, std::size_t count, char a, char b) {
+        std::size_t i = 0;
+        while (i < count && (cells[i] == a || cells[i] == b)) ++i;
+        return i;
+    }
+
+    void expandCellsScalar(const char *cells, std::size_t count, char *out) {
+        for (std::size_t i = 0; i < count; ++i) {
+            out[2 * i] = cells[i];
+            out[2 * i + 1] = ' ';
+        }
+    }
+
+    void overlayScalar(char *dst, const char *src, std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) {
+            if (src[i]) dst[i] = src[i];
+        }
+    }
+
+    const Kernels scalarKernels = {fillScalar, rowRootsScalar, runLengthScalar, expandCellsScalar, overlayScalar};
+
+#ifdef SBB_SIMD_X86
+    unsigned trailingZeros(unsigned mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+    }
+
+    SBB_TARGET_SSE2 void rowRootsSse2(long long base, int first, int count, int *roots) {
+        __m128d b = _mm_set1_pd(static_cast<double>(base));
+        __m128d i = _mm_set_pd(first + 1.0, first);
+        __m128d step = _mm_set1_pd(2.0);
+        __m128d zero = _mm_setzero_pd();
+        int k = 0;
+        for (; k + 2 <= count; k += 2) {
+            __m128d value = _mm_max_pd(_mm_sub_pd(b, _mm_mul_pd(i, i)), zero);
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(roots + k), _mm_cvttpd_epi32(_mm_sqrt_pd(value)));
+            i = _mm_add_pd(i, step);
+        }
+        rowRootsScalar(base, first + k, count - k, roots + k);
+        fixRoots(base, first, k, roots);
+    }
+
+    SBB_TARGET_SSE2 std::size_t runLengthSse2(const char *cells, std::size_t count, char a, char b) {
+        __m128i va = _mm_set1_epi8(a);
+        __m128i vb = _mm_set1_epi8(b);
+        std::size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cells + i));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(c, va),
+                                                                                 _mm_cmpeq_epi8(c, vb))));
+            if (mask != 0xFFFFu) return i + trailingZeros(~mask);
+        }
+        return i + runLengthScalar(cells + i, count - i, a, b);
+    }
+
+    SBB_TARGET_SSE2 void expandCellsSse2(const char *cells, std::size_t count, char *out) {
+        __m128i space = _mm_set1_epi8(' ');
+        std::size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cells + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i), _mm_unpacklo_epi8(c, space));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i + 16), _mm_unpackhi_epi8(c, space));
+        }
+        expandCellsScalar(cells + i, count - i, out + 2 * i);
+    }
+
+    SBB_TARGET_SSE2 void overlaySse2(char *dst, const char *src, std::size_t count) {
+        __m128i zero = _mm_setzero_si128();
+        std::size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+            __m128i clear = _mm_cmpeq_epi8(s, zero);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                             _mm_or_si128(_mm_and_si128(clear, d), _mm_andnot_si128(clear, s)));
+        }
+        overlayScalar(dst + i, src + i, count - i);
+    }
+
+    SBB_TARGET_AVX2 std::size_t runLengthAvx2(const char *cells, std::size_t count, char a, char b) {
+        __m256i va = _mm256_set1_epi8(a);
+        __m256i vb = _mm256_set1_epi8(b);
+        std::size_t i = 0;
+        for (; i + 32 <= count; i += 32) {
+            __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(cells + i));
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(c, va), _mm256_cmpeq_epi8(c, vb))));
+            if (mask != 0xFFFFFFFFu) return i + trailingZeros(~mask);
+        }
+        return i + runLengthScalar(cells + i, count - i, a, b);
+    }
+
+    SBB_TARGET_AVX2 void expandCellsAvx2(const char *cells, std::size_t count, char *out) {
+        __m256i space = _mm256_set1_epi8(' ');
+        std::size_t i = 0;
+        for (; i + 32 <= count; i += 32) {
+            __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(cells + i));
+            // The unpacks work within 128-bit lanes, so put the lane halves back in order.
+            __m256i low = _mm256_unpacklo_epi8(c, space);
+            __m256i high = _mm256_unpackhi_epi8(c, space);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 2 * i), _mm256_permute2x128_si256(low, high, 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 2 * i + 32),
+                                _mm256_permute2x128_si256(low, high, 0x31));
+        }
+        expandCellsScalar(cells + i, count - i, out + 2 * i);
+    }
+
+    SBB_TARGET_AVX2 void overlayAvx2(char *dst, const char *src, std::size_t count) {
+        __m256i zero = _mm256_setzero_si256();
+        std::size_t i = 0;
+        for (; i + 32 <= count; i += 32) {
+            __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+            __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+            __m256i clear = _mm256_cmpeq_epi8(s, zero);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_blendv_epi8(s, d, clear));
+        }
+        overlayScalar(dst + i, src + i, count - i);
+    }
+
+    // Each level takes the fastest kernel simd_bench measured per operation, not the widest one. Span
+    // fills stay on the libc memset, which vector stores never beat. Circle rows keep the SSE2 kernel
+    // on AVX2 CPUs, because the 4-wide version was slower than the 2-wide one.
+    const Kernels sse2Kernels = {fillScalar, rowRootsSse2, runLengthSse2, expandCellsSse2, overlaySse2};
+    const Kernels avx2Kernels = {fillScalar, rowRootsSse2, runLengthAvx2, expandCellsAvx2, overlayAvx2};
+
+    bool cpuHasSse2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 1);
+        return (info[3] & (1 << 26)) != 0;
+#else
+        return __builtin_cpu_supports("sse2");
+#endif
+    }
+
+    bool cpuHasAvx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) return false;
+        __cpuid(info, 1);
+        // AVX needs both the CPU flag and the OS saving the ymm registers.
+        bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+        __cpuidex(info, 7, 0);
+        return osSavesYmm && (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+
+    const Kernels &kernelsFor(Simd::Level level) {
+#ifdef SBB_SIMD_X86
+        switch (level) {
+            case Simd::AVX2:
+                return avx2Kernels;
+            case Simd::SSE2:
+                return sse2Kernels;
+            default:
+                break;
+        }
+#else
+        (void) level;
+#endif
+        return scalarKernels;
+    }
+
+    Simd::Level &activeLevel() {
+        static Simd::Level level = Simd::bestLevel();
+        return level;
+    }
+
+    const Kernels *&active() {
+        static const Kernels *kernels = &kernelsFor(activeLevel());
+        return kernels;
+    }
+}
+
+Simd::Level Simd::bestLevel() {
+#ifdef SBB_SIMD_X86
+    static const Level best = cpuHasAvx2() ? AVX2 : cpuHasSse2() ? SSE2 : SCALAR;
+    return best;
+#else
+    return SCALAR;
+#endif
+}
+
+Simd::Level Simd::level() {
+    return activeLevel();
+}
+
+void Simd::setLevel(Level level) {
+    if (level > bestLevel()) level = bestLevel();
+    activeLevel() = level;
+    active() = &kernelsFor(level);
+}
+
+const char *Simd::levelName(Level level) {
+    switch (level) {
+        case AVX2:
+            return "avx2";
+        case SSE2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
+
+void Simd::fill(char *dst, char value, std::size_t count) {
+    active()->fill(dst, value, count);
+}
+
+void Simd::rowRoots(long long base, int first, int count, int *roots) {
+    if (count > 0) active()->rowRoots(base, first, count, roots);
+}
+
+std::size_t Simd::runLength(const char *cells, std::size_t count, char a, char b) {
+    return active()->runLength(cells, count, a, b);
+}
+
+void Simd::expandCells(const char *cells, std::size_t count, char *out) {
+    active()->expandCells(cells, count, out);
+}
+
+void Simd::overlay(char *dst, const char *src, std::size_t count) {
+    active()->overlay(dst, src, count);
+}
@@ -0,0 +1,42 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cstddef>
+
+// Byte and row kernels for the raster and output paths, in scalar, SSE2 and AVX2 versions. The
+// best level the CPU supports is picked on first use; setLevel exists for benchmarks and checks.
+// A level is a table of the fastest measured kernel per operation, so a wider level may reuse a
+// narrower kernel: span fills and whole-board clears stay on memset, and AVX2 keeps the SSE2 circle rows.
+class Simd {
+public:
+    enum Level {
+        SCALAR,
+        SSE2,
+        AVX2
+    };
+
+    static Level level();
+
+    static Level bestLevel();
+
+    // Falls back to the best supported level when asked for one the CPU lacks.
+    static void setLevel(Level level);
+
+    static const char *levelName(Level level);
+
+    static void fill(char *dst, char value, std::size_t count);
+
+    // roots[k] = floor(sqrt(base - (first + k)^2)), or 0 where that is negative.
+    static void rowRoots(long long base, int first, int count, int *roots);
+
+    // Length of the prefix of cells made only of a and b.
+    static std::size_t runLength(const char *cells, std::size_t count, char a, char b);
+
+    // Writes each cell followed by a space: 2 * count bytes.
+    static void expandCells(const char *cells, std::size_t count, char *out);
+
+    // Copies the cells of src that are not '\0' over dst.
+    static void overlay(char *dst, const char *src, std::size_t count);
+};
+
+#endif
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include "SpatialIndex.h"
+
+SpatialIndex::SpatialIndex(int boardWidth, int boardHeight) {
+    reset(boardWidth, boardHeight);
+}
+
+void SpatialIndex::reset(int boardWidth, int boardHeight) {
+    this->boardWidth = std::max(boardWidth, 1);
+    this->boardHeight = std::max(boardHeight, 1);
+
+    int largest = std::max(this->boardWidth, this->boardHeight);
+    cellSize = std::max(minCellSize, (largest + maxCellsPerAxis - 1) / maxCellsPerAxis);
+    columns = (this->boardWidth + cellSize - 1) / cellSize;
+    rows = (this->boardHeight + cellSize - 1) / cellSize;
+
+    cells.assign(static_cast<std::size_t>(columns) * rows, {});
+}
+
+void SpatialIndex::clear() {
+    for (auto &cell: cells) {
+        cell.clear();
+    }
+    handleAt.clear();
+    positionOf.clear();
+    freeHandles.clear();
+    boxes.clear();
+    entries = 0;
+}
+
+Rect SpatialIndex::cellRange(const Rect &bounds) const {
+    Rect clipped = bounds.intersect({0, 0, boardWidth - 1, boardHeight - 1});
+    if (clipped.empty()) return clipped;
+    return {clipped.x0 / cellSize, clipped.y0 / cellSize, clipped.x1 / cellSize, clipped.y1 / cellSize};
+}
+
+void SpatialIndex::addToCells(std::uint32_t handle, const Rect &bounds) {
+    Rect range = cellRange(bounds);
+    if (range.empty()) return;
+
+    for (int row = range.y0; row <= range.y1; ++row) {
+        for (int column = range.x0; column <= range.x1; ++column) {
+            cells[static_cast<std::size_t>(row) * columns + column].push_back(handle);
+        }
+    }
+    entries += static_cast<std::size_t>(range.x1 - range.x0 + 1) * static_cast<std::size_t>(range.y1 - range.y0 + 1);
+}
+
+void SpatialIndex::removeFromCells(std::uint32_t handle, const Rect &bounds) {
+    Rect range = cellRange(bounds);
+    if (range.empty()) return;
+
+    for (int row = range.y0; row <= range.y1; ++row) {
+        for (int column = range.x0; column <= range.x1; ++column) {
+            auto &cell = cells[static_cast<std::size_t>(row) * columns + column];
+            auto it = std::find(cell.begin(), cell.end(), handle);
+            if (it == cell.end()) continue;
+            *it = cell.back();
+            cell.pop_back();
+            --entries;
+        }
+    }
+}
+
+void SpatialIndex::renumber(std::size_t first) {
+    for (std::size_t id = first; id < handleAt.size(); ++id) {
+        positionOf[handleAt[id]] = static_cast<std::uint32_t>(id);
+    }
+}
+
+void SpatialIndex::insert(std::size_t id, const Rect &bounds) {
+    std::uint32_t handle;
+    if (freeHandles.empty()) {
+        handle = static_cast<std::uint32_t>(positionOf.size());
+        positionOf.push_back(0);
+        boxes.emplace_back();
+    } else {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    }
+    handleAt.insert(handleAt.begin() + static_cast<std::ptrdiff_t>(id), handle);
+    renumber(id);
+    boxes[handle] = bounds;
+    addToCells(handle, bounds);
+}
+
+void SpatialIndex::erase(std::size_t id, const Rect &bounds) {
+    std::uint32_t handle = handleAt[id];
+    removeFromCells(handle, bounds);
+    handleAt.erase(handleAt.begin() + static_cast<std::ptrdiff_t>(id));
+    freeHandles.push_back(handle);
+    renumber(id);
+}
+
+void SpatialIndex::move(std::size_t id, const Rect &from, const Rect &to) {
+    removeFromCells(handleAt[id], from);
+    boxes[handleAt[id]] = to;
+    addToCells(handleAt[id], to);
+}
+
+void SpatialIndex::rebuild(const std::vector<std::shared_ptr<Shape>> &shapes) {
+    clear();
+    handleAt.reserve(shapes.size());
+    positionOf.reserve(shapes.size());
+    for (std::size_t i = 0; i < shapes.size(); ++i) {
+        insert(i, shapes[i]->getBounds());
+    }
+}
+
+void SpatialIndex::candidatesAt(int x, int y, std::vector<std::size_t> &ids) const {
+    ids.clear();
+    if (x < 0 || y < 0 || x >= boardWidth || y >= boardHeight) return;
+
+    for (std::uint32_t handle: cells[static_cast<std::size_t>(y / cellSize) * columns + x / cellSize]) {
+        ids.push_back(positionOf[handle]);
+    }
+    std::sort(ids.begin(), ids.end());
+}
+
+void SpatialIndex::query(const Rect &area, std::vector<std::size_t> &ids) const {
+    ids.clear();
+    Rect range = cellRange(area);
+    if (range.empty()) return;
+
+    // Once the cells in range hold about as many entries as there are shapes, walking them and
+    // dropping the duplicates costs more than testing every shape, which also comes out in order.
+    auto rangeCells = static_cast<std::size_t>(range.x1 - range.x0 + 1) *
+                      static_cast<std::size_t>(range.y1 - range.y0 + 1);
+    if (static_cast<double>(entries) * rangeCells >= static_cast<double>(handleAt.size()) * cells.size()) {
+        Rect clipped = area.intersect({0, 0, boardWidth - 1, boardHeight - 1});
+        for (std::size_t id = 0; id < handleAt.size(); ++id) {
+            if (boxes[handleAt[id]].intersects(clipped)) ids.push_back(id);
+        }
+        return;
+    }
+
+    for (int row = range.y0; row <= range.y1; ++row) {
+        for (int column = range.x0; column <= range.x1; ++column) {
+            for (std::uint32_t handle: cells[static_cast<std::size_t>(row) * columns + column]) {
+                ids.push_back(positionOf[handle]);
+            }
+        }
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
@@ -0,0 +1,63 @@
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Geometry.h"
+#include "Shape.h"
+
+// Uniform grid over the board. Cells keep stable handles of the shapes whose bounding box touches
+// them, not their ids (z-order positions in the shape list), so inserting or erasing a shape only
+// rewrites its own cells. Handles map back to ids through positionOf, which changes only for the
+// shapes above the insert or erase; at the top of the list both are O(1).
+class SpatialIndex {
+private:
+    static constexpr int minCellSize = 16;
+    static constexpr int maxCellsPerAxis = 512;
+
+    int boardWidth, boardHeight, cellSize, columns, rows;
+    std::vector<std::vector<std::uint32_t>> cells;
+    std::vector<std::uint32_t> handleAt, positionOf, freeHandles;
+    // Bounds by handle, for queries that would visit more cell entries than there are shapes.
+    std::vector<Rect> boxes;
+    // Handles held across all cells.
+    std::size_t entries = 0;
+
+    Rect cellRange(const Rect &bounds) const;
+
+    void addToCells(std::uint32_t handle, const Rect &bounds);
+
+    void removeFromCells(std::uint32_t handle, const Rect &bounds);
+
+    // Points the handles of ids from first up at their new positions.
+    void renumber(std::size_t first);
+
+public:
+    SpatialIndex(int boardWidth, int boardHeight);
+
+    void reset(int boardWidth, int boardHeight);
+
+    void clear();
+
+    // Mirrors an insert into the shape list: ids at or above id move up by one.
+    void insert(std::size_t id, const Rect &bounds);
+
+    // Mirrors an erase from the shape list: ids above id move down by one.
+    void erase(std::size_t id, const Rect &bounds);
+
+    // The shape at id now has new bounds.
+    void move(std::size_t id, const Rect &from, const Rect &to);
+
+    void rebuild(const std::vector<std::shared_ptr<Shape>> &shapes);
+
+    // Collects the ids whose bounding box may touch cell (x, y), sorted ascending, so walking them
+    // backwards visits the topmost shape first.
+    void candidatesAt(int x, int y, std::vector<std::size_t> &ids) const;
+
+    // Collects the ids whose bounding box may intersect area, sorted ascending and without duplicates.
+    void query(const Rect &area, std::vector<std::size_t> &ids) const;
+};
+
+#endif
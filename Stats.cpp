@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <string>
+#include "Stats.h"
+
+namespace {
+    // Power-of-two buckets over nanoseconds: bucket i holds samples in [2^i, 2^(i+1)).
+    struct Histogram {
+        static constexpr int bucketCount = 64;
+
+        std::uint64_t buckets[bucketCount] = {};
+        std::uint64_t count = 0, total = 0, min = 0, max = 0;
+
+        void add(std::uint64_t ns) {
+            int bucket = 0;
+            while (bucket + 1 < bucketCount && (ns >> (bucket + 1)) != 0) ++bucket;
+            ++buckets[bucket];
+            min = count == 0 || ns < min ? ns : min;
+            max = ns > max ? ns : max;
+            total += ns;
+            ++count;
+        }
+
+        // Upper edge of the bucket holding the nearest-rank q-th sample, kept within the observed range.
+        std::uint64_t percentile(double q) const {
+            if (count == 0) return 0;
+            auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(q * static_cast<double>(count))));
+            std::uint64_t seen = 0;
+            for (int bucket = 0; bucket < bucketCount; ++bucket) {
+                seen += buckets[bucket];
+                if (seen >= rank) {
+                    std::uint64_t edge = bucket + 1 < bucketCount ? (std::uint64_t(1) << (bucket + 1)) - 1 : max;
+                    return std::max(min, std::min(edge, max));
+                }
+            }
+            return max;
+        }
+
+        std::uint64_t mean() const {
+            return count ? total / count : 0;
+        }
+    };
+
+    const char *const counterNames[Stats::COUNTER_COUNT] = {
+            "shapes_rasterized", "cells_written", "history_bytes", "snapshot_bytes", "file_bytes_written",
+            "file_bytes_read", "pool_allocations", "pool_releases", "pool_chunks", "pool_chunks_released",
+            "tiles_allocated"};
+
+    const char *const timerNames[Stats::TIMER_COUNT] = {
+            "render", "present", "add_shape", "history_push", "save", "load", "autosave"};
+
+    std::atomic<std::uint64_t> counters[Stats::COUNTER_COUNT];
+
+    std::mutex histogramMutex;
+    Histogram timers[Stats::TIMER_COUNT];
+    std::map<std::string, Histogram, std::less<>> commands;
+
+    void printHistogram(std::ostream &os, const std::string &name, const Histogram &histogram) {
+        auto micros = [](std::uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+        os << '\t' << std::left << std::setw(20) << name << std::right
+           << std::setw(10) << histogram.count
+           << std::setw(12) << micros(histogram.mean())
+           << std::setw(12) << micros(histogram.percentile(0.5))
+           << std::setw(12) << micros(histogram.percentile(0.99))
+           << std::setw(12) << micros(histogram.max) << '\n';
+    }
+
+    void writeHistogram(std::ostream &os, const Histogram &histogram) {
+        os << "{\"count\": " << histogram.count << ", \"total_ns\": " << histogram.total
+           << ", \"min_ns\": " << histogram.min << ", \"mean_ns\": " << histogram.mean()
+           << ", \"p50_ns\": " << histogram.percentile(0.5) << ", \"p90_ns\": " << histogram.percentile(0.9)
+           << ", \"p99_ns\": " << histogram.percentile(0.99) << ", \"max_ns\": " << histogram.max << "}";
+    }
+}
+
+void Stats::add(Counter counter, std::uint64_t amount) {
+    counters[counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+void Stats::record(Timer timer, std::chrono::nanoseconds elapsed) {
+    std::lock_guard<std::mutex> lock(histogramMutex);
+    timers[timer].add(static_cast<std::uint64_t>(elapsed.count()));
+}
+
+void Stats::recordCommand(std::string_view name, std::chrono::nanoseconds elapsed) {
+    std::lock_guard<std::mutex> lock(histogramMutex);
+    auto it = commands.find(name);
+    if (it == commands.end()) it = commands.emplace(std::string(name), Histogram()).first;
+    it->second.add(static_cast<std::uint64_t>(elapsed.count()));
+}
+
+void Stats::reset() {
+    for (auto &counter: counters) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> lock(histogramMutex);
+    for (auto &timer: timers) {
+        timer = Histogram();
+    }
+    commands.clear();
+}
+
+void Stats::print(std::ostream &os) {
+    if (!enabled()) {
+        os << "Statistics are not collected in this build.\n";
+        return;
+    }
+
+    os << "Counters:\n";
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        os << '\t' << std::left << std::setw(20) << counterNames[i] << std::right
+           << std::setw(14) << counters[i].load(std::memory_order_relaxed) << '\n';
+    }
+
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << std::fixed << std::setprecision(1);
+
+    std::lock_guard<std::mutex> lock(histogramMutex);
+    const char *columns = "     count   mean (us)    p50 (us)    p99 (us)    max (us)\n";
+    os << "Timers:                 " << columns;
+    for (int i = 0; i < TIMER_COUNT; ++i) {
+        printHistogram(os, timerNames[i], timers[i]);
+    }
+    os << "Commands:               " << columns;
+    for (const auto &command: commands) {
+        printHistogram(os, command.first, command.second);
+    }
+
+    os.flags(flags);
+    os.precision(precision);
+}
+
+void Stats::writeJson(std::ostream &os) {
+    os << "{\"enabled\": " << (enabled() ? "true" : "false") << ", \"counters\": {";
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        os << (i ? ", \"" : "\"") << counterNames[i] << "\": " << counters[i].load(std::memory_order_relaxed);
+    }
+
+    std::lock_guard<std::mutex> lock(histogramMutex);
+    os << "},\n \"timers\": {";
+    for (int i = 0; i < TIMER_COUNT; ++i) {
+        os << (i ? ",\n  \"" : "\n  \"") << timerNames[i] << "\": ";
+        writeHistogram(os, timers[i]);
+    }
+    os << "},\n \"commands\": {";
+    bool first = true;
+    for (const auto &command: commands) {
+        os << (first ? "\n  \"" : ",\n  \"") << command.first << "\": ";
+        writeHistogram(os, command.second);
+        first = false;
+    }
+    os << "}}\n";
+}
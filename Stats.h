@@ -0,0 +1,91 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+// Build with BLACKBOARD_STATS=0 to compile every STATS_ macro away.
+#ifndef BLACKBOARD_STATS
+#define BLACKBOARD_STATS 0
+#endif
+
+// Process-wide counters and latency histograms. Counters are relaxed atomics, so render threads can
+// bump them; histograms take a lock per sample and are meant for whole operations, not inner loops.
+class Stats {
+public:
+    enum Counter {
+        SHAPES_RASTERIZED,
+        CELLS_WRITTEN,
+        HISTORY_BYTES,
+        SNAPSHOT_BYTES,
+        FILE_BYTES_WRITTEN,
+        FILE_BYTES_READ,
+        POOL_ALLOCATIONS,
+        POOL_RELEASES,
+        POOL_CHUNKS,
+        POOL_CHUNKS_RELEASED,
+        TILES_ALLOCATED,
+        COUNTER_COUNT
+    };
+
+    enum Timer {
+        RENDER,
+        PRESENT,
+        ADD_SHAPE,
+        HISTORY_PUSH,
+        SAVE,
+        LOAD,
+        AUTOSAVE,
+        TIMER_COUNT
+    };
+
+    // Times the enclosing scope into one of the timers.
+    class ScopedTimer {
+    private:
+        Timer timer;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        explicit ScopedTimer(Timer timer) : timer(timer), start(std::chrono::steady_clock::now()) {}
+
+        ~ScopedTimer() {
+            Stats::record(timer, std::chrono::steady_clock::now() - start);
+        }
+
+        ScopedTimer(const ScopedTimer &) = delete;
+
+        ScopedTimer &operator=(const ScopedTimer &) = delete;
+    };
+
+    static constexpr bool enabled() {
+        return BLACKBOARD_STATS != 0;
+    }
+
+    static void add(Counter counter, std::uint64_t amount);
+
+    static void record(Timer timer, std::chrono::nanoseconds elapsed);
+
+    // Latency of one CLI command, by name.
+    static void recordCommand(std::string_view name, std::chrono::nanoseconds elapsed);
+
+    static void reset();
+
+    // A table for people, for the stats command.
+    static void print(std::ostream &os);
+
+    static void writeJson(std::ostream &os);
+};
+
+#if BLACKBOARD_STATS
+#define STATS_CONCAT_(a, b) a##b
+#define STATS_CONCAT(a, b) STATS_CONCAT_(a, b)
+#define STATS_TIME(timer) Stats::ScopedTimer STATS_CONCAT(statsTimer, __LINE__)(Stats::timer)
+#define STATS_ADD(counter, amount) Stats::add(Stats::counter, (amount))
+#else
+#define STATS_TIME(timer) ((void) 0)
+#define STATS_ADD(counter, amount) ((void) 0)
+#endif
+
+#endif
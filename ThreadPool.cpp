@@ -0,0 +1,99 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned threadCount) : job(nullptr), generation(0), remaining(0), stopping(false) {
+    if (threadCount == 0) threadCount = 1;
+
+    for (unsigned i = 0; i < threadCount; ++i) {
+        queues.push_back(std::make_unique<TaskQueue>());
+    }
+    // The last queue belongs to the thread that calls parallelFor.
+    for (unsigned i = 0; i + 1 < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker: workers) {
+        worker.join();
+    }
+}
+
+bool ThreadPool::popTask(std::size_t self, std::size_t &task) {
+    {
+        TaskQueue &own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (std::size_t i = 1; i < queues.size(); ++i) {
+        TaskQueue &victim = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::drain(std::size_t self) {
+    std::size_t task;
+    while (popTask(self, task)) {
+        (*job)(task);
+        if (remaining.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.notify_all();
+        }
+    }
+}
+
+void ThreadPool::workerLoop(std::size_t self) {
+    std::size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        drain(self);
+    }
+}
+
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)> &body) {
+    if (count == 0) return;
+    if (queues.size() == 1) {
+        for (std::size_t i = 0; i < count; ++i) body(i);
+        return;
+    }
+
+    {
+        // A worker still scanning from the previous round may pick up a task as soon as it is queued,
+        // so the job and the count have to be in place first.
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &body;
+        remaining = count;
+        for (std::size_t i = 0; i < count; ++i) {
+            TaskQueue &queue = *queues[i % queues.size()];
+            std::lock_guard<std::mutex> queueLock(queue.mutex);
+            queue.tasks.push_back(i);
+        }
+        ++generation;
+    }
+    wake.notify_all();
+
+    drain(queues.size() - 1);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return remaining.load() == 0; });
+    job = nullptr;
+}
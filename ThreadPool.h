@@ -0,0 +1,57 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of workers with one task deque each. A parallelFor deals the indices out round-robin;
+// every worker drains its own deque from the back and, once empty, steals from the front of the
+// others, so uneven tasks still keep all threads busy. The calling thread joins in as a worker.
+class ThreadPool {
+private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    const std::function<void(std::size_t)> *job;
+    std::size_t generation;
+    std::atomic<std::size_t> remaining;
+    bool stopping;
+
+    bool popTask(std::size_t self, std::size_t &task);
+
+    void drain(std::size_t self);
+
+    void workerLoop(std::size_t self);
+
+public:
+    explicit ThreadPool(unsigned threadCount);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned threadCount() const {
+        return static_cast<unsigned>(queues.size());
+    }
+
+    // Runs body(0) .. body(count - 1) across the pool and returns when all of them have finished.
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)> &body);
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cstring>
+#include "Simd.h"
+#include "Stats.h"
+#include "TiledFramebuffer.h"
+
+namespace {
+    constexpr std::size_t tileCells = static_cast<std::size_t>(TiledFramebuffer::tileSize) *
+                                      TiledFramebuffer::tileSize;
+}
+
+TiledFramebuffer::TiledFramebuffer(int w, int h, char blank) : width(0), height(0), tilesAcross(0), blank(blank) {
+    resize(w, h);
+}
+
+void TiledFramebuffer::resize(int w, int h) {
+    width = w > 0 ? w : 0;
+    height = h > 0 ? h : 0;
+    tilesAcross = (width + tileSize - 1) / tileSize;
+    tiles.clear();
+}
+
+void TiledFramebuffer::clear() {
+    tiles.clear();
+}
+
+char *TiledFramebuffer::tileAt(int tileX, int tileY) {
+    auto &tile = tiles[keyOf(tileX, tileY)];
+    if (!tile) {
+        tile.reset(new char[tileCells]);
+        std::memset(tile.get(), blank, tileCells);
+        STATS_ADD(TILES_ALLOCATED, 1);
+    }
+    return tile.get();
+}
+
+char TiledFramebuffer::at(int x, int y) const {
+    auto it = tiles.find(keyOf(x / tileSize, y / tileSize));
+    if (it == tiles.end()) return blank;
+    return it->second[static_cast<std::size_t>(y % tileSize) * tileSize + x % tileSize];
+}
+
+void TiledFramebuffer::fillInTile(int tileX, int tileY, const Rect &area, char symbol) {
+    char *cells;
+    if (symbol != blank) {
+        cells = tileAt(tileX, tileY);
+    } else {
+        // Nothing to blank in a tile that does not exist, and nothing left in one covered whole.
+        auto it = tiles.find(keyOf(tileX, tileY));
+        if (it == tiles.end()) return;
+        if (area.x1 - area.x0 + 1 == tileSize && area.y1 - area.y0 + 1 == tileSize) {
+            tiles.erase(it);
+            return;
+        }
+        cells = it->second.get();
+    }
+
+    int left = tileX * tileSize, top = tileY * tileSize;
+    auto columns = static_cast<std::size_t>(area.x1 - area.x0 + 1);
+    for (int y = area.y0; y <= area.y1; ++y) {
+        Simd::fill(cells + static_cast<std::size_t>(y - top) * tileSize + (area.x0 - left), symbol, columns);
+    }
+}
+
+void TiledFramebuffer::fillSpan(const Span &span, char symbol) {
+    int tileY = span.y / tileSize;
+    for (int tileX = span.x0 / tileSize; tileX <= span.x1 / tileSize; ++tileX) {
+        int left = tileX * tileSize;
+        fillInTile(tileX, tileY, {std::max(span.x0, left), span.y, std::min(span.x1, left + tileSize - 1), span.y},
+                   symbol);
+    }
+}
+
+void TiledFramebuffer::fillSpans(const std::vector<Span> &spans, char symbol) {
+    for (const auto &span: spans) {
+        fillSpan(span, symbol);
+    }
+}
+
+void TiledFramebuffer::fillRect(const Rect &area, char symbol) {
+    if (area.empty()) return;
+    for (int tileY = area.y0 / tileSize; tileY <= area.y1 / tileSize; ++tileY) {
+        int top = tileY * tileSize;
+        for (int tileX = area.x0 / tileSize; tileX <= area.x1 / tileSize; ++tileX) {
+            int left = tileX * tileSize;
+            fillInTile(tileX, tileY, area.intersect({left, top, left + tileSize - 1, top + tileSize - 1}), symbol);
+        }
+    }
+}
+
+std::vector<TiledFramebuffer::Tile> TiledFramebuffer::allocatedTiles() const {
+    std::vector<std::pair<std::uint64_t, const char *>> sorted;
+    sorted.reserve(tiles.size());
+    for (const auto &tile: tiles) {
+        sorted.emplace_back(tile.first, tile.second.get());
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    std::vector<Tile> result;
+    result.reserve(sorted.size());
+    for (const auto &tile: sorted) {
+        auto tileX = static_cast<int>(tile.first % static_cast<std::uint64_t>(tilesAcross));
+        auto tileY = static_cast<int>(tile.first / static_cast<std::uint64_t>(tilesAcross));
+        result.push_back({tileX * tileSize, tileY * tileSize, tile.second});
+    }
+    return result;
+}
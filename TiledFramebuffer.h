@@ -0,0 +1,78 @@
+#ifndef TILEDFRAMEBUFFER_H
+#define TILEDFRAMEBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Geometry.h"
+
+// A board kept as square tiles that only exist where something was drawn, for boards far too big
+// to hold whole. A tile is allocated by the first non-blank write to it and released again when it
+// is cleared, so memory follows the painted area rather than the board size. Cells outside every
+// tile read as blank.
+class TiledFramebuffer {
+public:
+    static constexpr int tileSize = 32;
+
+    // One allocated tile: tileSize rows of tileSize cells starting at board cell (x, y). Cells past
+    // the right or bottom edge of the board are never written.
+    struct Tile {
+        int x, y;
+        const char *cells;
+    };
+
+private:
+    int width, height, tilesAcross;
+    char blank;
+    std::unordered_map<std::uint64_t, std::unique_ptr<char[]>> tiles;
+
+    std::uint64_t keyOf(int tileX, int tileY) const {
+        return static_cast<std::uint64_t>(tileY) * static_cast<std::uint64_t>(tilesAcross) +
+               static_cast<std::uint64_t>(tileX);
+    }
+
+    char *tileAt(int tileX, int tileY);
+
+    // Fills columns x0..x1 of rows y0..y1, all inside one tile.
+    void fillInTile(int tileX, int tileY, const Rect &area, char symbol);
+
+public:
+    TiledFramebuffer(int w, int h, char blank = ' ');
+
+    // Releases every tile.
+    void resize(int w, int h);
+
+    void clear();
+
+    int getWidth() const {
+        return width;
+    }
+
+    int getHeight() const {
+        return height;
+    }
+
+    std::size_t tileCount() const {
+        return tiles.size();
+    }
+
+    char at(int x, int y) const;
+
+    void fillSpan(const Span &span, char symbol);
+
+    void fillSpans(const std::vector<Span> &spans, char symbol);
+
+    // Filling with the blank releases the tiles the area covers whole.
+    void fillRect(const Rect &area, char symbol);
+
+    bool contains(int x, int y) const {
+        return x >= 0 && y >= 0 && x < width && y < height;
+    }
+
+    // The allocated tiles, top row of tiles first and left to right within a row.
+    std::vector<Tile> allocatedTiles() const;
+};
+
+#endif
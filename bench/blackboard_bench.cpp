@@ -0,0 +1,372 @@
+// End-to-end timings for the board on synthetic scenes. Every scene comes from a fixed seed, so two
+// builds given the same arguments time the same work. Results go to stdout (or --out) as JSON:
+//
+//   {"version": 1, "seed": 1, "threads": 1, "results": [
+//     {"scenario": "medium-1000-mixed-mixed", "width": 400, "height": 200, "shapes": 1000,
+//      "mix": "mixed", "fill": "mixed", "benchmark": "draw_full", "ops": 120, "total_ns": 1234,
+//      "ns_per_op": 10.3}, ...]}
+//
+// Usage: blackboard_bench [--quick] [--seed <n>] [--threads <n>] [--filter <text>] [--out <file>]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "Blackboard.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Swallows the board's user messages so they cost what they cost without flooding the output.
+    class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int c) override {
+            return c;
+        }
+    };
+
+    enum class Mix {
+        MIXED,
+        RECTANGLES,
+        CIRCLES,
+        TRIANGLES,
+        LINES
+    };
+
+    enum class Fill {
+        MIXED,
+        FILL,
+        FRAME
+    };
+
+    const char *mixName(Mix mix) {
+        switch (mix) {
+            case Mix::RECTANGLES:
+                return "rectangles";
+            case Mix::CIRCLES:
+                return "circles";
+            case Mix::TRIANGLES:
+                return "triangles";
+            case Mix::LINES:
+                return "lines";
+            default:
+                return "mixed";
+        }
+    }
+
+    const char *fillName(Fill fill) {
+        switch (fill) {
+            case Fill::FILL:
+                return "fill";
+            case Fill::FRAME:
+                return "frame";
+            default:
+                return "mixed";
+        }
+    }
+
+    struct Scenario {
+        std::string name;
+        int width, height;
+        std::size_t shapes;
+        Mix mix;
+        Fill fill;
+    };
+
+    struct Options {
+        bool quick = false;
+        unsigned seed = 1;
+        unsigned threads = 1;
+        std::string filter;
+        std::string outPath;
+    };
+
+    struct Result {
+        const Scenario *scenario;
+        std::string benchmark;
+        std::size_t ops;
+        long long totalNs;
+    };
+
+    std::vector<Scenario> makeScenarios(bool quick) {
+        struct Size {
+            const char *name;
+            int width, height;
+        };
+        const Size sizes[] = {{"small", 80, 40}, {"medium", 400, 200}, {"large", 2000, 1000}};
+        std::vector<std::size_t> counts = quick ? std::vector<std::size_t>{100, 1000}
+                                                : std::vector<std::size_t>{100, 1000, 10000};
+
+        std::vector<Scenario> scenarios;
+        for (const auto &size: sizes) {
+            for (std::size_t count: counts) {
+                scenarios.push_back({std::string(size.name) + "-" + std::to_string(count) + "-mixed-mixed",
+                                     size.width, size.height, count, Mix::MIXED, Fill::MIXED});
+            }
+        }
+        for (Mix mix: {Mix::RECTANGLES, Mix::CIRCLES, Mix::TRIANGLES, Mix::LINES}) {
+            for (Fill fill: {Fill::FILL, Fill::FRAME}) {
+                // Lines have no fill mode, so they get a single scenario.
+                if (mix == Mix::LINES) fill = Fill::MIXED;
+                scenarios.push_back({std::string("medium-1000-") + mixName(mix) + "-" + fillName(fill),
+                                     400, 200, 1000, mix, fill});
+                if (mix == Mix::LINES) break;
+            }
+        }
+        return scenarios;
+    }
+
+    // Shapes sized up to a tenth of the board, all inside it, drawn from rng in a fixed order.
+    std::vector<std::shared_ptr<Shape>> makeScene(const Scenario &scenario, std::mt19937 &rng) {
+        const char colours[] = {'r', 'g', 'b', 'y', 'k'};
+        int maxSize = std::max(2, std::min(scenario.width, scenario.height) / 10);
+        auto pick = [&rng](int n) { return static_cast<int>(rng() % static_cast<unsigned>(n)); };
+
+        std::vector<std::shared_ptr<Shape>> shapes;
+        shapes.reserve(scenario.shapes);
+        while (shapes.size() < scenario.shapes) {
+            int x = pick(scenario.width), y = pick(scenario.height);
+            int a = 1 + pick(maxSize), b = 1 + pick(maxSize);
+            char colour = colours[pick(5)];
+            bool fillMode = scenario.fill == Fill::FILL || (scenario.fill == Fill::MIXED && pick(2) == 0);
+            Mix kind = scenario.mix == Mix::MIXED ? static_cast<Mix>(1 + pick(4)) : scenario.mix;
+
+            std::shared_ptr<Shape> shape;
+            switch (kind) {
+                case Mix::CIRCLES:
+                    shape = makePooled<Circle>(x, y, colour, fillMode, a);
+                    break;
+                case Mix::TRIANGLES:
+                    shape = makePooled<Triangle>(x, y, colour, fillMode, a, b);
+                    break;
+                case Mix::LINES:
+                    shape = makePooled<Line>(x, y, colour, false, a * 2, pick(360));
+                    break;
+                default:
+                    shape = makePooled<SRectangle>(x, y, colour, fillMode, a, b);
+                    break;
+            }
+            if (shape->isWithinBounds(scenario.width, scenario.height)) shapes.push_back(shape);
+        }
+        return shapes;
+    }
+
+    long long elapsedNs(Clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+    // Repeats body until minNs has passed; body returns how many operations it did.
+    Result repeat(const Scenario &scenario, const std::string &name, long long minNs,
+                  const std::function<std::size_t()> &body) {
+        body();
+        std::size_t ops = 0;
+        auto start = Clock::now();
+        long long total;
+        do {
+            ops += body();
+            total = elapsedNs(start);
+        } while (total < minNs);
+        return {&scenario, name, ops, total};
+    }
+
+    Result once(const Scenario &scenario, const std::string &name, const std::function<std::size_t()> &body) {
+        auto start = Clock::now();
+        std::size_t ops = body();
+        return {&scenario, name, ops, elapsedNs(start)};
+    }
+
+    std::unique_ptr<Blackboard> makeBoard(const Scenario &scenario, const Options &options) {
+        auto board = std::make_unique<Blackboard>(scenario.width, scenario.height);
+        board->setOutput(std::make_unique<NullSink>());
+        board->setRenderThreads(options.threads);
+        return board;
+    }
+
+    void runScenario(const Scenario &scenario, const Options &options, std::vector<Result> &results) {
+        std::mt19937 rng(options.seed);
+        std::vector<std::shared_ptr<Shape>> shapes = makeScene(scenario, rng);
+        long long minNs = options.quick ? 20'000'000 : 200'000'000;
+
+        auto board = makeBoard(scenario, options);
+        results.push_back(once(scenario, "add_shape", [&] {
+            for (const auto &shape: shapes) board->addShape(shape);
+            return shapes.size();
+        }));
+
+        results.push_back(repeat(scenario, "draw_full", minNs, [&] {
+            board->invalidateAll();
+            board->draw();
+            return std::size_t(1);
+        }));
+
+        results.push_back(repeat(scenario, "render_full", minNs, [&] {
+            board->invalidateAll();
+            board->render();
+            return std::size_t(1);
+        }));
+
+        // The whole board through an 80x40 window zoomed out to fit it.
+        int zoom = std::max((scenario.width + 79) / 80, (scenario.height + 39) / 40);
+        board->setViewport({0, 0, 80, 40, zoom});
+        results.push_back(repeat(scenario, "render_viewport_zoomed", minNs, [&] {
+            board->renderViewport();
+            return std::size_t(1);
+        }));
+        board->setViewport({0, 0, 0, 0, 1});
+
+        // One shape on a layer above the whole scene, moved and redrawn: only that layer is
+        // rasterized again, the scene's layer is only composited.
+        auto layered = makeBoard(scenario, options);
+        for (const auto &shape: shapes) layered->addShape(shape);
+        layered->useLayer("top");
+        layered->addShape(makePooled<Circle>(scenario.width / 2, scenario.height / 2, 'r', true, 3));
+        layered->selectId(static_cast<int>(shapes.size()));
+        layered->render();
+        int step = 0;
+        results.push_back(repeat(scenario, "move_top_layer", minNs, [&] {
+            ++step;
+            layered->editPosition(step % scenario.width, step % scenario.height);
+            layered->render();
+            return std::size_t(1);
+        }));
+
+        // Adds under a full layer: every shape goes to the bottom of the z-order, so each add and its
+        // undo renumber the whole scene above it.
+        auto lower = makeBoard(scenario, options);
+        lower->useLayer("top");
+        for (const auto &shape: shapes) lower->addShape(shape);
+        lower->useLayer("base");
+        std::vector<std::shared_ptr<Shape>> underneath = makeScene(scenario, rng);
+        std::size_t added = 0;
+        results.push_back(once(scenario, "add_lower_layer", [&] {
+            for (const auto &shape: underneath) added += lower->addShape(shape);
+            return added;
+        }));
+        results.push_back(once(scenario, "undo_lower_layer", [&] {
+            for (std::size_t i = 0; i < added; ++i) lower->undo();
+            return added;
+        }));
+
+        std::filesystem::path base = std::filesystem::temp_directory_path() / ("blackboard_bench_" + scenario.name);
+        std::string imagePath = base.string() + ".ppm";
+        results.push_back(repeat(scenario, "export_ppm", minNs, [&] {
+            board->exportImage(imagePath);
+            return std::size_t(1);
+        }));
+        std::remove(imagePath.c_str());
+
+        std::vector<std::pair<int, int>> points(1000);
+        for (auto &point: points) {
+            point = {static_cast<int>(rng() % scenario.width), static_cast<int>(rng() % scenario.height)};
+        }
+        results.push_back(repeat(scenario, "select_position", minNs, [&] {
+            for (const auto &point: points) board->selectPosition(point.first, point.second);
+            return points.size();
+        }));
+
+        for (SceneFormat format: {SceneFormat::TEXT, SceneFormat::BINARY}) {
+            std::string suffix = format == SceneFormat::TEXT ? "text" : "binary";
+            std::string path = base.string() + (format == SceneFormat::TEXT ? ".txt" : ".sbb");
+            results.push_back(repeat(scenario, "save_" + suffix, minNs, [&] {
+                board->save(path, format);
+                return std::size_t(1);
+            }));
+            results.push_back(repeat(scenario, "load_" + suffix, minNs, [&] {
+                board->load(path);
+                return std::size_t(1);
+            }));
+            std::remove(path.c_str());
+        }
+
+        // Undo and redo every add on a fresh board, so each step is one shape.
+        auto history = makeBoard(scenario, options);
+        for (const auto &shape: shapes) history->addShape(shape);
+        results.push_back(once(scenario, "undo", [&] {
+            std::size_t ops = 0;
+            while (history->undo()) ++ops;
+            return ops;
+        }));
+        results.push_back(once(scenario, "redo", [&] {
+            std::size_t ops = 0;
+            while (history->redo()) ++ops;
+            return ops;
+        }));
+    }
+
+    void writeJson(std::ostream &os, const Options &options, const std::vector<Result> &results) {
+        os << "{\"version\": 1, \"seed\": " << options.seed << ", \"threads\": " << options.threads
+           << ", \"results\": [\n";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const Result &result = results[i];
+            const Scenario &scenario = *result.scenario;
+            double perOp = result.ops ? static_cast<double>(result.totalNs) / result.ops : 0.0;
+            os << "  {\"scenario\": \"" << scenario.name << "\", \"width\": " << scenario.width
+               << ", \"height\": " << scenario.height << ", \"shapes\": " << scenario.shapes
+               << ", \"mix\": \"" << mixName(scenario.mix) << "\", \"fill\": \"" << fillName(scenario.fill)
+               << "\", \"benchmark\": \"" << result.benchmark << "\", \"ops\": " << result.ops
+               << ", \"total_ns\": " << result.totalNs << ", \"ns_per_op\": " << perOp << "}"
+               << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        os << "]}\n";
+    }
+
+    bool parseOptions(int argc, char *argv[], Options &options) {
+        for (int i = 1; i < argc; ++i) {
+            if (std::strcmp(argv[i], "--quick") == 0) {
+                options.quick = true;
+            } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+                options.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+            } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+                options.threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+            } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+                options.filter = argv[++i];
+            } else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+                options.outPath = argv[++i];
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--quick] [--seed <n>] [--threads <n>] [--filter <text>] [--out <file>]\n";
+        return 1;
+    }
+
+    std::vector<Scenario> scenarios = makeScenarios(options.quick);
+    std::vector<Result> results;
+
+    NullBuffer nullBuffer;
+    std::streambuf *stdoutBuffer = std::cout.rdbuf(&nullBuffer);
+    for (const auto &scenario: scenarios) {
+        if (!options.filter.empty() && scenario.name.find(options.filter) == std::string::npos) continue;
+        std::cerr << "running " << scenario.name << '\n';
+        runScenario(scenario, options, results);
+    }
+    std::cout.rdbuf(stdoutBuffer);
+
+    if (options.outPath.empty()) {
+        writeJson(std::cout, options, results);
+    } else {
+        std::ofstream out(options.outPath);
+        writeJson(out, options, results);
+        if (!out) {
+            std::cerr << "Cannot write " << options.outPath << '\n';
+            return 1;
+        }
+    }
+    return 0;
+}
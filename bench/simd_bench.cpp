@@ -0,0 +1,96 @@
+// Times each Simd kernel at every level this CPU supports and prints the speedup over the scalar
+// and the SSE2 versions; the default (best) level should never come out below 1.00x of SSE2. Built
+// as the simd_bench CMake target.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include "ConsoleOutput.h"
+#include "Framebuffer.h"
+#include "Simd.h"
+
+namespace {
+    volatile std::size_t sink;
+
+    // Nanoseconds per call, one timed round.
+    double timeRound(const std::function<void()> &kernel, int calls) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < calls; ++i) kernel();
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / calls;
+    }
+
+    // Best of a few rounds per level. The rounds take turns across levels, so drift on a busy machine
+    // lands on every level alike instead of on whichever one runs last.
+    void report(const char *name, const std::function<void()> &kernel, int calls) {
+        std::vector<double> best(Simd::bestLevel() + 1, 1e300);
+        for (int round = 0; round < 5; ++round) {
+            for (int level = Simd::SCALAR; level <= Simd::bestLevel(); ++level) {
+                Simd::setLevel(static_cast<Simd::Level>(level));
+                best[level] = std::min(best[level], timeRound(kernel, calls));
+            }
+        }
+        for (int level = Simd::SCALAR; level <= Simd::bestLevel(); ++level) {
+            double ns = best[level];
+            std::printf("%-28s %-7s %12.1f ns  %6.2fx", name, Simd::levelName(static_cast<Simd::Level>(level)), ns,
+                        best[Simd::SCALAR] / ns);
+            if (level >= Simd::SSE2) std::printf("  %6.2fx vs sse2", best[Simd::SSE2] / ns);
+            std::printf("%s\n", level == Simd::bestLevel() ? "  (default)" : "");
+        }
+        Simd::setLevel(Simd::bestLevel());
+    }
+}
+
+int main() {
+    std::mt19937 rng(12345);
+    const int width = 1920, height = 1080;
+    Framebuffer board(width, height);
+
+    // Short spans like the ones shapes produce on a terminal-sized board.
+    std::vector<Span> spans(4096);
+    for (auto &span: spans) {
+        span.y = static_cast<int>(rng() % height);
+        span.x0 = static_cast<int>(rng() % (width - 200));
+        span.x1 = span.x0 + static_cast<int>(rng() % 120);
+    }
+    report("span fill (4096 spans)", [&] { board.fillSpans(spans, 'r'); }, 200);
+
+    std::vector<int> roots(2001);
+    report("circle rows (r=1000)", [&] {
+        Simd::rowRoots(1000LL * 1000, -1000, 2001, roots.data());
+        sink = static_cast<std::size_t>(roots[1000]);
+    }, 2000);
+
+    // A mostly blank board with runs of colour, then every row encoded for output.
+    board.fill(' ');
+    for (int i = 0; i < 300; ++i) {
+        int y = static_cast<int>(rng() % height), x = static_cast<int>(rng() % (width - 300));
+        board.fillSpan({y, x, x + static_cast<int>(rng() % 300)}, "rgbyk"[rng() % 5]);
+    }
+    std::string line;
+    report("board to output (1920x1080)", [&] {
+        for (int y = 0; y < height; ++y) {
+            AnsiConsole::encodeRow(board.row(y), width, line);
+            sink = line.size();
+        }
+    }, 20);
+
+    // A sparse layer with the same runs over the board, as the compositor merges them.
+    Framebuffer layer(width, height, '\0');
+    for (int i = 0; i < 300; ++i) {
+        int y = static_cast<int>(rng() % height), x = static_cast<int>(rng() % (width - 300));
+        layer.fillSpan({y, x, x + static_cast<int>(rng() % 300)}, "rgbyk"[rng() % 5]);
+    }
+    report("layer overlay (1920x1080)", [&] {
+        for (int y = 0; y < height; ++y) {
+            Simd::overlay(board.row(y), layer.row(y), width);
+        }
+        sink = static_cast<std::size_t>(board.at(0, 0));
+    }, 20);
+
+    return 0;
+}
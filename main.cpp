@@ -1,23 +1,105 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include "Blackboard.h"
 #include "CLI.h"
+#include "Stats.h"
 
-int main() {
-    int width, height;
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
-    std::cout << "Enter the width of the blackboard: ";
-    std::cin >> width;
-    std::cout << "Enter the height of the blackboard: ";
-    std::cin >> height;
+namespace {
+    bool stdinIsTerminal() {
+#ifdef _WIN32
+        return _isatty(_fileno(stdin)) != 0;
+#else
+        return isatty(STDIN_FILENO) != 0;
+#endif
+    }
+}
+
+int main(int argc, char *argv[]) {
+    // Nothing here uses C stdio, so the iostreams can buffer on their own instead of per write.
+    std::ios::sync_with_stdio(false);
+
+    int width = 0, height = 0;
+    std::string autosavePath, scriptPath, statsPath;
+    long autosaveInterval = 5000;
+    long renderThreads = 1;
+    long loadLimit = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--autosave") == 0 && i + 1 < argc) {
+            autosavePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--autosave-interval") == 0 && i + 1 < argc) {
+            autosaveInterval = std::strtol(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            renderThreads = std::strtol(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--load-limit") == 0 && i + 1 < argc) {
+            loadLimit = std::strtol(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--script") == 0 && i + 1 < argc) {
+            scriptPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--stats-json") == 0 && i + 1 < argc) {
+            statsPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--size") == 0 && i + 2 < argc) {
+            width = static_cast<int>(std::strtol(argv[++i], nullptr, 10));
+            height = static_cast<int>(std::strtol(argv[++i], nullptr, 10));
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--autosave <file-path>] [--autosave-interval <ms>]"
+                      << " [--threads <count>] [--load-limit <MiB>] [--size <width> <height>] [--script <file-path>]"
+                      << " [--stats-json <file-path>]" << std::endl;
+            return 1;
+        }
+    }
+
+    // Piped input runs as a script, without prompts or help.
+    bool terminal = stdinIsTerminal();
+    if (width == 0 && height == 0) {
+        if (terminal) std::cout << "Enter the width of the blackboard: ";
+        std::cin >> width;
+        if (terminal) std::cout << "Enter the height of the blackboard: ";
+        std::cin >> height;
+    }
 
     if (width <= 0 || height <= 0) {
         std::cerr << "Invalid board dimensions. Exiting program." << std::endl;
         return 1;
     }
 
-    Blackboard blackboard(width, height);
-    CLI cli(blackboard);
+    {
+        Blackboard blackboard(width, height);
+        blackboard.setRenderThreads(renderThreads > 0 ? static_cast<unsigned>(renderThreads) : 1);
+        if (loadLimit > 0) blackboard.setLoadLimit(static_cast<std::size_t>(loadLimit) << 20);
+        CLI cli(blackboard);
+
+        if (!autosavePath.empty()) {
+            cli.enableAutosave(autosavePath, std::chrono::milliseconds(autosaveInterval > 0 ? autosaveInterval : 1));
+        }
 
-    cli.run();
+        if (!scriptPath.empty()) {
+            cli.runScriptFile(scriptPath);
+        } else if (terminal) {
+            cli.run();
+        } else {
+            std::string script((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+            cli.runScript(script);
+        }
+    }
+
+    // After the CLI is gone, so the autosaver's last write is counted too.
+    if (!statsPath.empty()) {
+        std::ofstream out(statsPath);
+        Stats::writeJson(out);
+        if (!out) {
+            std::cerr << "Cannot write " << statsPath << std::endl;
+            return 1;
+        }
+    }
 
     return 0;
-}
\ No newline at end of file
+}
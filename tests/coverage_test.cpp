@@ -0,0 +1,97 @@
+// Checks that every shape's point test agrees with its rasterizer: on random boards, each cell a
+// shape draws must be one coversPoint reports, and no other. Shapes are placed anywhere around the
+// board, so many are clipped by its edges, and each is also drawn through a random clip rect.
+//
+// Usage: coverage_test [--seed <n>] [--shapes <n>]
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include "Framebuffer.h"
+#include "Shape.h"
+
+namespace {
+    std::shared_ptr<Shape> makeShape(std::mt19937 &rng, int width, int height) {
+        auto pick = [&rng](int lo, int hi) {
+            return lo + static_cast<int>(rng() % static_cast<unsigned>(hi - lo + 1));
+        };
+        int maxSize = std::max(width, height);
+        int x = pick(-maxSize / 4, width + maxSize / 4), y = pick(-maxSize / 4, height + maxSize / 4);
+        int a = pick(1, maxSize), b = pick(1, maxSize);
+        bool fillMode = pick(0, 1) == 0;
+
+        switch (pick(0, 3)) {
+            case 0:
+                return std::make_shared<SRectangle>(x, y, 'r', fillMode, a, b);
+            case 1:
+                return std::make_shared<Circle>(x, y, 'r', fillMode, a / 2);
+            case 2:
+                return std::make_shared<Triangle>(x, y, 'r', fillMode, a, b);
+            default:
+                return std::make_shared<Line>(x, y, 'r', false, a, pick(0, 359) + pick(0, 9) / 10.0);
+        }
+    }
+
+    // Compares the cells drawn inside clip against coversPoint. Returns the number of mismatches,
+    // reporting the first.
+    int check(const Shape &shape, Framebuffer &board, const Rect &clip) {
+        board.fill(' ');
+        shape.draw(board, clip);
+
+        int mismatches = 0;
+        for (int y = 0; y < board.getHeight(); ++y) {
+            for (int x = 0; x < board.getWidth(); ++x) {
+                bool drawn = board.at(x, y) != ' ';
+                bool covered = clip.contains(x, y) && shape.coversPoint(board, x, y);
+                if (drawn == covered) continue;
+                if (mismatches++ == 0) {
+                    std::cerr << shape.getType() << " at (" << shape.getPosition().first << ", "
+                              << shape.getPosition().second << ") " << (shape.getFillMode() ? "fill" : "frame")
+                              << ' ' << shape.describe() << " on " << board.getWidth() << 'x' << board.getHeight()
+                              << ", clip (" << clip.x0 << ", " << clip.y0 << ")-(" << clip.x1 << ", " << clip.y1
+                              << "): cell (" << x << ", " << y << ") is " << (drawn ? "drawn" : "not drawn")
+                              << " but " << (covered ? "covered" : "not covered") << ".\n";
+                }
+            }
+        }
+        return mismatches;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    unsigned seed = 1;
+    int count = 2000;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--shapes") == 0 && i + 1 < argc) {
+            count = std::atoi(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--seed <n>] [--shapes <n>]\n";
+            return 2;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    Framebuffer board(1, 1);
+    int failed = 0;
+    for (int i = 0; i < count; ++i) {
+        int width = 1 + static_cast<int>(rng() % 120), height = 1 + static_cast<int>(rng() % 60);
+        board.resize(width, height);
+        std::shared_ptr<Shape> shape = makeShape(rng, width, height);
+
+        int x0 = static_cast<int>(rng() % width), y0 = static_cast<int>(rng() % height);
+        Rect clip{x0, y0, x0 + static_cast<int>(rng() % (width - x0)), y0 + static_cast<int>(rng() % (height - y0))};
+        if (check(*shape, board, {0, 0, width - 1, height - 1}) || check(*shape, board, clip)) ++failed;
+    }
+
+    if (failed) {
+        std::cerr << failed << " of " << count << " shapes drew cells their point test disagrees with.\n";
+        return 1;
+    }
+    std::cout << "All " << count << " shapes drew exactly the cells they cover.\n";
+    return 0;
+}
@@ -0,0 +1,73 @@
+// Checks that size edits the schema rejects leave the board alone: a zero or negative size, the
+// wrong number of values, or a size too big for the board must fail without changing the shape or
+// pushing anything onto the undo history. Also checks that a snapshot keeps the scene it was taken
+// from while the board is edited after it.
+
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Blackboard.h"
+
+namespace {
+    int failures = 0;
+
+    void expect(bool condition, const std::string &what) {
+        if (condition) return;
+        ++failures;
+        std::cerr << "FAILED: " << what << '\n';
+    }
+
+    std::string describeOnly(const Blackboard &board) {
+        Blackboard::Snapshot snapshot = board.snapshot();
+        return snapshot.shapes->size() == 1 ? (*snapshot.shapes)[0]->describe() : "";
+    }
+
+    void checkRejected(const std::vector<float> &values, const std::string &what) {
+        Blackboard board(30, 10);
+        board.addShape(std::make_shared<SRectangle>(2, 2, 'r', true, 5, 3));
+        board.selectId(0);
+        std::string before = describeOnly(board);
+
+        expect(!board.editParams(values.data(), values.size()), what + " is rejected");
+        expect(describeOnly(board) == before, what + " leaves the shape as it was");
+        // The only history entry is the add: one undo empties the board and there is nothing after it.
+        expect(board.undo() && board.snapshot().shapes->empty(), what + " pushes no history");
+        expect(!board.undo(), what + " pushes no history");
+    }
+}
+
+int main() {
+    // The board's own messages are not what is being tested.
+    std::ostringstream quiet;
+    std::streambuf *console = std::cout.rdbuf(quiet.rdbuf());
+
+    checkRejected({-3, 2}, "a negative width");
+    checkRejected({4, 0}, "a zero height");
+    checkRejected({4}, "too few values");
+    checkRejected({31, 2}, "a width wider than the board");
+
+    Blackboard board(30, 10);
+    board.addShape(std::make_shared<SRectangle>(2, 2, 'r', true, 5, 3));
+    board.selectId(0);
+    const float values[] = {6, 4};
+    expect(board.editParams(values, 2), "a valid edit is accepted");
+    expect(describeOnly(board) == "Width: 6, Height: 4", "a valid edit resizes the shape");
+
+    Blackboard::Snapshot snapshot = board.snapshot();
+    const float grown[] = {8, 5};
+    board.editParams(grown, 2);
+    board.addShape(std::make_shared<Circle>(20, 5, 'g', false, 2));
+    expect(snapshot.shapes->size() == 1 && (*snapshot.shapes)[0]->describe() == "Width: 6, Height: 4",
+           "a snapshot is unchanged by later edits");
+    expect(board.snapshot().shapes->size() == 2, "the board sees its own edits after a snapshot");
+
+    std::cout.rdbuf(console);
+    if (failures) {
+        std::cerr << failures << " check(s) failed.\n";
+        return 1;
+    }
+    std::cout << "Rejected edits left the board and its history unchanged, and snapshots held.\n";
+    return 0;
+}